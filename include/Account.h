@@ -10,6 +10,13 @@
 #include <memory>
 #include <cstring>
 #include <tuple>
+#include <cmath>
+#include <map>
+#include <iterator>
+#include <algorithm>
+#include "FxRates.h"
+#include "FileLock.h"
+#include "Schema.h"
 
 // Class representing financial account
 class Account
@@ -20,13 +27,26 @@ private:
 
     static const std::set<std::string> validTypes_;
 
+    friend struct Schema<Account>;
+
 public:
     std::string name_;
     std::string bank_;
     std::string type_;
+    std::string currency_;
+    std::string owner_;
+    // Free-form labels separated by ';'
+    std::string tags_;
+
+    // Constructor to initialize an account, balances are held in currency c
+    Account(const std::string &n, const std::string &b, double bal, double i, const std::string &t, const std::string &c = FxRates::pivot_,
+            const std::string &o = "", const std::string &g = "");
+
+    // Throw if the account type is not one of the valid types
+    void Validate() const;
 
-    // Constructor to initialize an account
-    Account(const std::string &n, const std::string &b, double bal, double i, const std::string &t);
+    // True if t is one of the valid account types
+    static bool ValidType(const std::string &t);
 
     // Getters and setters for balance and interest
     double balance() const;
@@ -37,6 +57,28 @@ public:
 
     // Append single account to accounts CSV file
     void AddAccountToCSV();
+
+    // Append the account to out as a single accounts CSV row
+    void WriteCSVRow(std::string &out) const;
+
+    // True if every field matches, allowing for rounding when amounts pass through CSV
+    bool SameAs(const Account &other) const;
+};
+
+// Accounts CSV row layout, rows from before currency, owner and tags were added stop after the type
+template <>
+struct Schema<Account>
+{
+    static constexpr auto fields_ = std::make_tuple(
+        MakeField("Name", &Account::name_),
+        MakeField("Bank", &Account::bank_),
+        MakeField("Balance", &Account::balance_),
+        MakeField("Interest", &Account::interest_),
+        MakeField("Type", &Account::type_),
+        MakeField("Currency", &Account::currency_),
+        MakeField("Owner", &Account::owner_),
+        MakeField("Tags", &Account::tags_));
+    static constexpr size_t required_ = 5;
 };
 
 // Class representing financial summary
@@ -52,36 +94,185 @@ public:
     double giaBalance_;
     double cryptoBalance_;
     double totalInterest_;
+    // Currency all balances are expressed in
+    std::string currency_;
+    // Balances of the configured account groups, by "Key/value" name
+    std::map<std::string, double> groupTotals_;
 
     /**
      * Constructor to calculate financial summary.
      *
+     * Balances are summed per currency first, then each currency total is converted once.
+     *
      * @param accountList A vector of Account objects to calculate the summary from.
+     * @param rates Exchange rates used to convert account currencies.
+     * @param baseCurrency Currency to express the summary in.
+     */
+    FinanceSummary(const std::vector<Account> &accountList, const FxRates &rates = FxRates(), const std::string &baseCurrency = FxRates::pivot_);
+
+    // Constructor to create a summary with zero balances
+    FinanceSummary(const std::string &date = "", const std::string &currency = FxRates::pivot_);
+
+    /**
+     * Append the summary as a single history CSV row.
+     *
+     * @param out String to append the row to.
+     */
+    void WriteCSVRow(std::string &out) const;
+
+    /**
+     * Compare balances with another summary, ignoring the date.
+     *
+     * @param other Summary to compare against.
+     * @param epsilon Largest difference per field still treated as unchanged.
+     * @return True if no field differs by more than epsilon.
      */
-    FinanceSummary(const std::vector<Account> &accountList);
+    bool SameBalancesAs(const FinanceSummary &other, double epsilon) const;
 
-    FinanceSummary(std::string date, double totalBalance, double currentBalance, double savingsBalance, double creditBalance, double isaBalance, double giaBalance, double cryptoBalance, double totalInterest);
     /**
-     * Append a snapshot of financial summary to history CSV file.
+     * Revalue the summary in another currency at the rate in effect on its date.
+     *
+     * @param currency Currency to convert to.
+     * @param rates Exchange rates to convert with.
+     * @return Converted copy of the summary.
+     */
+    FinanceSummary ConvertedTo(const std::string &currency, const FxRates &rates) const;
+
+    /**
+     * Adjust the totals for an edited account without revisiting the others.
+     *
+     * @param before Account as it was summarised.
+     * @param after Account after the edit.
+     * @param rates Exchange rates the summary was made with.
      */
-    void SaveFinanceSummary() const;
+    void ApplyChange(const Account &before, const Account &after, const FxRates &rates);
+
+private:
+    // Add a single account's balance to the totals, without conversion
+    void Accumulate(const Account &account);
+
+    // Add another summary's totals scaled by rate
+    void AddScaled(const FinanceSummary &other, double rate);
+};
+
+// History CSV row layout, followed by the group totals. The balances are the plotted series,
+// and each balance with an account type sums the accounts of that type.
+template <>
+struct Schema<FinanceSummary>
+{
+    static constexpr auto fields_ = std::make_tuple(
+        MakeField("Date", &FinanceSummary::date_),
+        MakeField("Total", &FinanceSummary::totalBalance_, "Total Balance"),
+        MakeField("Current", &FinanceSummary::currentBalance_, "Current Balance", "Current"),
+        MakeField("Savings", &FinanceSummary::savingsBalance_, "Savings Balance", "Savings"),
+        MakeField("Credit", &FinanceSummary::creditBalance_, "Credit Balance", "Credit"),
+        MakeField("ISA", &FinanceSummary::isaBalance_, "ISA Balance", "ISA"),
+        MakeField("GIA", &FinanceSummary::giaBalance_, "GIA Balance", "GIA"),
+        MakeField("Crypto", &FinanceSummary::cryptoBalance_, "Crypto Balance", "Crypto"),
+        MakeField("Interest", &FinanceSummary::totalInterest_, "Total Interest"),
+        MakeField("Currency", &FinanceSummary::currency_));
+    static constexpr size_t required_ = 9;
+};
+
+// Interface for views that follow the saved summary history
+class HistoryObserver
+{
+public:
+    virtual ~HistoryObserver() {}
+
+    // Called after summaries are added to the end of the history
+    virtual void OnSummariesAdded(const std::vector<FinanceSummary> &added) = 0;
+
+    // Called after the history is replaced, e.g. because its file was rewritten
+    virtual void OnHistoryReset() = 0;
 };
 
 // Class holding application saved data
 class SavedData
 {
+private:
+    // Bytes of history CSV file already parsed, and the last parsed row used to spot rewrites
+    std::streamoff historyOffset_;
+    std::string historyTail_;
+    // Snapshots at the end of savedSummaryList_ not yet written, kept when the file is reloaded
+    size_t unwrittenCount_;
+
+    // Accounts as last read from or written to accounts CSV file, and the file's stamp then
+    std::vector<Account> storedAccounts_;
+    FileStamp accountsStamp_;
+
+    // Parse complete history rows after the offset, returning false if the file no longer extends what was read
+    bool ReadHistoryRows(std::vector<FinanceSummary> &added);
+    bool ReadNewSummariesLocked(std::vector<FinanceSummary> &added);
+    void ParseHistoryLine(const std::string &line, std::vector<FinanceSummary> &financeSummaryList);
+    bool WriteSummaryRows(const std::vector<FinanceSummary> &summaries, std::vector<FinanceSummary> &external);
+
+    // Views to tell about history changes, not owned
+    std::vector<HistoryObserver *> historyObservers_;
+    void NotifyHistory(const std::vector<FinanceSummary> &added, bool appended);
+
 public:
     std::vector<Account> accountList_;
     std::vector<FinanceSummary> savedSummaryList_;
+    FxRates fxRates_;
+    std::string baseCurrency_;
     FinanceSummary currentSummary_;
 
     SavedData();
 
+    // Summarise the current accounts in the base currency
+    FinanceSummary Summarise() const;
+
+    // Currencies of accounts that cannot be converted to the base currency, and so are left out of totals
+    std::set<std::string> UnconvertibleCurrencies() const;
+
     // Load list of accounts from accounts CSV file
     std::vector<Account> LoadAccountsFromCSV();
     std::vector<FinanceSummary> loadFinanceSummaryFromCSV();
-    std::vector<std::tuple<std::vector<double>, std::vector<double>>> getFinanceSummaryPoints();
-    void UpdateAccountsInCSV(std::vector<Account> accountList);
+
+    /**
+     * Rewrite accounts CSV file with the given accounts, under an exclusive lock.
+     *
+     * Nothing is written if another writer changed the file since it was last read or written,
+     * as that would drop their changes; reload and merge the accounts, then try again.
+     *
+     * @param accountList Accounts to write.
+     * @return True if the file was written.
+     */
+    bool UpdateAccountsInCSV(const std::vector<Account> &accountList);
+
+    // Accounts as they were in the file when it was last read or written, to merge other writers' changes against
+    const std::vector<Account> &StoredAccounts() const;
+
+    // True if accounts CSV file may have changed since it was last read or written, e.g. by another writer
+    bool AccountsFileChanged() const;
+
+    /**
+     * Append rows other writers added to history CSV file since the last read.
+     *
+     * @param added Output vector, overwritten with the new rows.
+     * @return True if rows were only appended, false if the file was rewritten and every row was reloaded into added.
+     */
+    bool ReadNewSummaries(std::vector<FinanceSummary> &added);
+
+    /**
+     * Append snapshots to history CSV file in one write, under an exclusive lock.
+     *
+     * The snapshots are expected to be the unwritten ones at the end of savedSummaryList_. Rows
+     * other writers added beforehand are read in first, as ReadNewSummaries does.
+     *
+     * @param summaries Snapshots to write.
+     * @param external Output vector, overwritten with rows read from other writers.
+     * @return As for ReadNewSummaries.
+     */
+    bool AppendSummariesToCSV(const std::vector<FinanceSummary> &summaries, std::vector<FinanceSummary> &external);
+
+    // Add an unwritten snapshot to the end of the history in memory and tell observers
+    void AddSnapshot(const FinanceSummary &summary);
+
+    // Register or unregister a view to be told about history changes
+    void AddHistoryObserver(HistoryObserver *observer);
+    void RemoveHistoryObserver(HistoryObserver *observer);
 };
 
 // Implementation
@@ -89,15 +280,23 @@ public:
 // Account
 const std::set<std::string> Account::validTypes_ = {"Savings", "Current", "Credit", "ISA", "GIA", "Crypto"};
 
-Account::Account(const std::string &n, const std::string &b, double bal, double i, const std::string &t)
-    : name_(n), bank_(b), balance_(bal), interest_(i), type_(t)
+Account::Account(const std::string &n, const std::string &b, double bal, double i, const std::string &t, const std::string &c,
+                 const std::string &o, const std::string &g)
+    : name_(n), bank_(b), balance_(bal), interest_(i), type_(t), currency_(c), owner_(o), tags_(g)
+{
+    Validate();
+}
+
+void Account::Validate() const
 {
-    if (validTypes_.find(t) == validTypes_.end())
+    if (!ValidType(type_))
     {
         throw std::invalid_argument("Invalid account type");
     }
 }
 
+bool Account::ValidType(const std::string &t) { return validTypes_.count(t) > 0; }
+
 double Account::balance() const { return balance_; }
 
 void Account::setBalance(double bal) { balance_ = bal; }
@@ -108,108 +307,191 @@ void Account::setInterest(double i) { interest_ = i; }
 
 void Account::AddAccountToCSV()
 {
+    FileLock lock("accounts.csv", true);
     std::ofstream file("accounts.csv", std::ios::app);
     if (!file.is_open())
     {
         throw std::runtime_error("File is not open");
     }
 
-    file << name_ << "," << bank_ << "," << balance() << "," << interest() << "," << type_ << std::endl;
+    std::string row;
+    WriteCSVRow(row);
+    file << row;
     file.close();
 }
 
-// Finance Summary
-FinanceSummary::FinanceSummary(const std::vector<Account> &accountList)
+void Account::WriteCSVRow(std::string &out) const
+{
+    EncodeCSV(*this, out);
+    out += '\n';
+}
+
+bool Account::SameAs(const Account &other) const
 {
-    totalBalance_ = 0;
-    currentBalance_ = 0;
-    savingsBalance_ = 0;
-    creditBalance_ = 0;
-    isaBalance_ = 0;
-    giaBalance_ = 0;
-    cryptoBalance_ = 0;
-    totalInterest_ = 0;
+    return AllFields<Account>([&](const auto &field)
+                              {
+                                  const auto &a = this->*field.member_;
+                                  const auto &b = other.*field.member_;
+                                  if constexpr (IsNumericField<decltype(field)>)
+                                      return std::fabs(a - b) <= 1e-9 * std::max(1.0, std::fabs(a));
+                                  else
+                                      return a == b; });
+}
 
+// Finance Summary
+FinanceSummary::FinanceSummary(const std::vector<Account> &accountList, const FxRates &rates, const std::string &baseCurrency)
+    : FinanceSummary("", baseCurrency)
+{
+    // Partial sums per currency, so each currency is converted once rather than per account
+    std::map<std::string, FinanceSummary> partials;
     for (const Account &account : accountList)
     {
-        totalBalance_ += account.balance();
-        totalInterest_ += account.interest() * account.balance() * 0.01;
-
-        if (account.type_ == "Current")
-        {
-            currentBalance_ += account.balance();
-        }
-        else if (account.type_ == "Savings")
-        {
-            savingsBalance_ += account.balance();
-        }
-        else if (account.type_ == "Credit")
-        {
-            creditBalance_ += account.balance();
-        }
-        else if (account.type_ == "ISA")
-        {
-            isaBalance_ += account.balance();
-        }
-        else if (account.type_ == "GIA")
-        {
-            giaBalance_ += account.balance();
-        }
-        else if (account.type_ == "Crypto")
+        auto partial = partials.find(account.currency_);
+        if (partial == partials.end())
         {
-            cryptoBalance_ += account.balance();
+            partial = partials.emplace(account.currency_, FinanceSummary("", account.currency_)).first;
         }
+        partial->second.Accumulate(account);
+    }
+
+    int today = Today();
+    for (const auto &partial : partials)
+    {
+        AddScaled(partial.second, rates.Rate(partial.first, currency_, today));
     }
+
     time_t now = time(0);
     char *dt = ctime(&now);
     tm *gmtm = gmtime(&now);
     date_ = asctime(gmtm);
+    // asctime terminates with a newline, which would split the history row
+    date_.erase(date_.find_last_not_of("\n") + 1);
+}
+
+FinanceSummary::FinanceSummary(const std::string &date, const std::string &currency)
+    : date_(date), currency_(currency)
+{
+    ForEachNumericField<FinanceSummary>([this](const auto &field)
+                                        { this->*field.member_ = 0; });
 }
 
-FinanceSummary::FinanceSummary(std::string date, double totalBalance, double currentBalance, double savingsBalance, double creditBalance, double isaBalance, double giaBalance, double cryptoBalance, double totalInterest)
-    : date_(date), totalBalance_(totalBalance), currentBalance_(currentBalance), savingsBalance_(savingsBalance),
-      creditBalance_(creditBalance), isaBalance_(isaBalance), giaBalance_(giaBalance),
-      cryptoBalance_(cryptoBalance), totalInterest_(totalInterest) {}
+void FinanceSummary::Accumulate(const Account &account)
+{
+    totalBalance_ += account.balance();
+    totalInterest_ += account.interest() * account.balance() * 0.01;
+
+    ForEachNumericField<FinanceSummary>([&](const auto &field)
+                                        {
+                                            if (field.accountType_ && account.type_ == field.accountType_)
+                                                this->*field.member_ += account.balance(); });
+}
 
-void FinanceSummary::SaveFinanceSummary() const
+void FinanceSummary::AddScaled(const FinanceSummary &other, double rate)
 {
-    std::ofstream file("history.csv", std::ios::app);
-    if (!file.good())
+    ForEachNumericField<FinanceSummary>([&](const auto &field)
+                                        { this->*field.member_ += other.*field.member_ * rate; });
+    for (const auto &group : other.groupTotals_)
     {
-        std::ofstream file("history.csv");
-        file.close();
-        return;
+        groupTotals_[group.first] += group.second * rate;
     }
-    if (!file.is_open())
+}
+
+FinanceSummary FinanceSummary::ConvertedTo(const std::string &currency, const FxRates &rates) const
+{
+    // Undated rows (written before dates were kept on one line) use today's rate
+    int day;
+    if (!ParseSummaryDate(date_, day))
     {
-        std::cerr << "Error opening file" << std::endl;
-        return;
+        day = Today();
     }
-    time_t now = time(0);
-    char *dt = ctime(&now);
-    tm *gmtm = gmtime(&now);
-    dt = asctime(gmtm);
+    FinanceSummary converted(date_, currency);
+    converted.AddScaled(*this, rates.Rate(currency_, currency, day));
+    return converted;
+}
 
-    file << dt << "," << totalBalance_ << "," << currentBalance_ << "," << savingsBalance_ << "," << creditBalance_ << "," << isaBalance_ << "," << giaBalance_ << "," << cryptoBalance_ << "," << totalInterest_ << "," << std::endl;
-    file.close();
+void FinanceSummary::ApplyChange(const Account &before, const Account &after, const FxRates &rates)
+{
+    int today = Today();
+    FinanceSummary removed("", before.currency_);
+    removed.Accumulate(before);
+    AddScaled(removed, -rates.Rate(before.currency_, currency_, today));
+    FinanceSummary added("", after.currency_);
+    added.Accumulate(after);
+    AddScaled(added, rates.Rate(after.currency_, currency_, today));
+}
+
+void FinanceSummary::WriteCSVRow(std::string &out) const
+{
+    EncodeCSV(*this, out);
+    for (const auto &group : groupTotals_)
+    {
+        out += ',';
+        out += group.first;
+        out += '=';
+        EncodeCSVValue(out, group.second);
+    }
+    out += '\n';
+}
+
+bool FinanceSummary::SameBalancesAs(const FinanceSummary &other, double epsilon) const
+{
+    bool balancesSame = AllFields<FinanceSummary>([&](const auto &field)
+                                                  {
+                                                      if constexpr (IsNumericField<decltype(field)>)
+                                                          return std::fabs(this->*field.member_ - other.*field.member_) <= epsilon;
+                                                      else
+                                                          return true; });
+    return balancesSame &&
+           currency_ == other.currency_ &&
+           groupTotals_.size() == other.groupTotals_.size() &&
+           std::equal(groupTotals_.begin(), groupTotals_.end(), other.groupTotals_.begin(),
+                      [epsilon](const std::pair<const std::string, double> &a, const std::pair<const std::string, double> &b)
+                      { return a.first == b.first && std::fabs(a.second - b.second) <= epsilon; });
 }
 
 // Saved Data
 SavedData::SavedData()
-    : accountList_(LoadAccountsFromCSV()),
+    : historyOffset_(0),
+      unwrittenCount_(0),
+      accountList_(LoadAccountsFromCSV()),
       savedSummaryList_(loadFinanceSummaryFromCSV()),
-      currentSummary_(accountList_)
+      baseCurrency_(FxRates::pivot_),
+      currentSummary_(std::vector<Account>())
+{
+    // Rates must be loaded before the accounts can be summarised
+    fxRates_.LoadFromCSV();
+    currentSummary_ = Summarise();
+}
+
+FinanceSummary SavedData::Summarise() const
+{
+    return FinanceSummary(accountList_, fxRates_, baseCurrency_);
+}
+
+std::set<std::string> SavedData::UnconvertibleCurrencies() const
 {
+    std::set<std::string> currencies;
+    for (const Account &account : accountList_)
+    {
+        if (!fxRates_.Converts(account.currency_, baseCurrency_))
+        {
+            currencies.insert(account.currency_);
+        }
+    }
+    return currencies;
 }
 
 std::vector<Account> SavedData::LoadAccountsFromCSV()
 {
     std::vector<Account> accountList;
+    FileLock lock("accounts.csv", false);
     std::ifstream file("accounts.csv");
     if (!file.good())
     {
         std::ofstream file("accounts.csv");
         file.close();
+        storedAccounts_.clear();
+        accountsStamp_ = FileStamp("accounts.csv");
         return accountList;
     }
     if (!file.is_open())
@@ -221,119 +503,228 @@ std::vector<Account> SavedData::LoadAccountsFromCSV()
 
     while (std::getline(file, line))
     {
-        std::istringstream ss(line);
-        std::string name, bank, type;
-        double balance, interest;
-        if (std::getline(ss, name, ',') &&
-            std::getline(ss, bank, ',') &&
-            ss >> balance &&
-            ss.ignore() &&
-            ss >> interest &&
-            ss.ignore() &&
-            std::getline(ss, type))
+        Account account("", "", 0, 0, "Current");
+        const char *pos = line.data();
+        if (DecodeCSV(pos, line.data() + line.size(), account))
         {
-            accountList.push_back(Account(name, bank, balance, interest, type));
+            // Rows written before currencies were added hold pivot currency balances
+            if (account.currency_.empty())
+            {
+                account.currency_ = FxRates::pivot_;
+            }
+            // Files are also edited by hand, so a bad row is reported and skipped rather than thrown
+            if (!Account::ValidType(account.type_))
+            {
+                std::cerr << "Invalid account type in: " << line << std::endl;
+                continue;
+            }
+            accountList.push_back(account);
         }
     }
+    storedAccounts_ = accountList;
+    accountsStamp_ = FileStamp("accounts.csv");
     return accountList;
 }
 
 std::vector<FinanceSummary> SavedData::loadFinanceSummaryFromCSV()
 {
     std::vector<FinanceSummary> financeSummaryList;
-    std::ifstream file("history.csv");
-    if (!file.good())
+    // Locking creates the file if it does not exist yet
+    FileLock lock("history.csv", false);
+    historyOffset_ = 0;
+    historyTail_.clear();
+    ReadHistoryRows(financeSummaryList);
+    return financeSummaryList;
+}
+
+bool SavedData::ReadNewSummaries(std::vector<FinanceSummary> &added)
+{
+    bool appended;
     {
-        std::ofstream file("history.csv");
-        file.close();
-        return financeSummaryList;
+        FileLock lock("history.csv", false);
+        appended = ReadNewSummariesLocked(added);
     }
-    if (!file.is_open())
+    NotifyHistory(added, appended);
+    return appended;
+}
+
+bool SavedData::ReadNewSummariesLocked(std::vector<FinanceSummary> &added)
+{
+    added.clear();
+    if (ReadHistoryRows(added))
     {
-        std::cerr << "Error opening file" << std::endl;
-        return financeSummaryList;
+        savedSummaryList_.insert(savedSummaryList_.end(), added.begin(), added.end());
+        return true;
     }
-    std::string line;
 
-    while (std::getline(file, line))
+    // The file was rewritten rather than appended to, so start over, keeping snapshots still to be written
+    added.clear();
+    historyOffset_ = 0;
+    historyTail_.clear();
+    ReadHistoryRows(added);
+    std::vector<FinanceSummary> unwritten(savedSummaryList_.end() - static_cast<std::ptrdiff_t>(unwrittenCount_), savedSummaryList_.end());
+    savedSummaryList_ = added;
+    savedSummaryList_.insert(savedSummaryList_.end(), unwritten.begin(), unwritten.end());
+    return false;
+}
+
+bool SavedData::ReadHistoryRows(std::vector<FinanceSummary> &added)
+{
+    // Re-read the last parsed row as well, to check the file still starts with what was read
+    std::streamoff start = historyOffset_ - static_cast<std::streamoff>(historyTail_.size());
+    std::string text;
+    std::ifstream file("history.csv", std::ios::binary);
+    if (file.is_open())
     {
-        std::istringstream ss(line);
-        std::string date;
-        double totalBalance, currentBalance, savingsBalance, creditBalance, isaBalance, giaBalance, cryptoBalance, totalInterest;
-        if (std::getline(ss, date, ',') &&
-            ss >> totalBalance &&
-            ss.ignore() &&
-            ss >> currentBalance &&
-            ss.ignore() &&
-            ss >> savingsBalance &&
-            ss.ignore() &&
-            ss >> creditBalance &&
-            ss.ignore() &&
-            ss >> isaBalance &&
-            ss.ignore() &&
-            ss >> giaBalance &&
-            ss.ignore() &&
-            ss >> cryptoBalance &&
-            ss.ignore() &&
-            ss >> totalInterest)
+        file.seekg(0, std::ios::end);
+        if (file.tellg() < historyOffset_)
         {
-            financeSummaryList.push_back(FinanceSummary(date, totalBalance, currentBalance, savingsBalance, creditBalance, isaBalance, giaBalance, cryptoBalance, totalInterest));
+            return false;
         }
+        file.seekg(start);
+        text.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
     }
-    return financeSummaryList;
+    if (text.compare(0, historyTail_.size(), historyTail_) != 0)
+    {
+        return false;
+    }
+
+    // Only complete rows are parsed, a partly written row is picked up on the next read
+    size_t lineStart = historyTail_.size();
+    size_t lastLineStart = std::string::npos;
+    size_t lineEnd;
+    while ((lineEnd = text.find('\n', lineStart)) != std::string::npos)
+    {
+        ParseHistoryLine(text.substr(lineStart, lineEnd - lineStart), added);
+        lastLineStart = lineStart;
+        lineStart = lineEnd + 1;
+    }
+    if (lastLineStart != std::string::npos)
+    {
+        historyTail_ = text.substr(lastLineStart, lineStart - lastLineStart);
+    }
+    historyOffset_ = start + static_cast<std::streamoff>(lineStart);
+    return true;
+}
+
+void SavedData::ParseHistoryLine(const std::string &line, std::vector<FinanceSummary> &financeSummaryList)
+{
+    FinanceSummary summary;
+    const char *pos = line.data();
+    const char *end = line.data() + line.size();
+    if (!DecodeCSV(pos, end, summary))
+    {
+        return;
+    }
+    // Rows written before currencies were added end in an empty field
+    if (summary.currency_.empty())
+    {
+        summary.currency_ = FxRates::pivot_;
+    }
+
+    // Followed by any number of "Key/value=balance" group totals
+    while (pos != end)
+    {
+        const char *comma = std::find(pos, end, ',');
+        std::string group(pos, comma);
+        size_t split = group.rfind('=');
+        double balance;
+        if (split != std::string::npos && DecodeCSVValue(group.data() + split + 1, group.data() + group.size(), balance))
+        {
+            summary.groupTotals_[group.substr(0, split)] = balance;
+        }
+        pos = comma == end ? end : comma + 1;
+    }
+    financeSummaryList.push_back(summary);
 }
 
+bool SavedData::AppendSummariesToCSV(const std::vector<FinanceSummary> &summaries, std::vector<FinanceSummary> &external)
+{
+    bool appended = WriteSummaryRows(summaries, external);
+    NotifyHistory(external, appended);
+    return appended;
+}
 
-std::vector<std::tuple<std::vector<double>, std::vector<double>>> SavedData::getFinanceSummaryPoints()
-{
-    std::vector<std::tuple<std::vector<double>, std::vector<double>>> summaryPoints;
-    std::vector<double> dates;
-    std::vector<double> totalBalances;
-    std::vector<double> currentBalances;
-    std::vector<double> savingsBalances;
-    std::vector<double> creditBalances;
-    std::vector<double> isaBalances;
-    std::vector<double> giaBalances;
-    std::vector<double> cryptoBalances;
-    std::vector<double> totalInterests;
-    double i = 0;
-    for (const auto &summary : savedSummaryList_)
+bool SavedData::WriteSummaryRows(const std::vector<FinanceSummary> &summaries, std::vector<FinanceSummary> &external)
+{
+    FileLock lock("history.csv", true);
+    // Read in other writers' rows first, so moving the offset past ours skips nothing else
+    bool appended = ReadNewSummariesLocked(external);
+    if (summaries.empty())
     {
-        // Convert the date string to char* and store it in the dates vector
-        std::string dateStr = summary.date_;
-        char *date = new char[dateStr.length() + 1];
-        strcpy(date, dateStr.c_str());
-        dates.push_back(i);
-        i++;
-
-        totalBalances.push_back(summary.totalBalance_);
-        currentBalances.push_back(summary.currentBalance_);
-        savingsBalances.push_back(summary.savingsBalance_);
-        creditBalances.push_back(summary.creditBalance_);
-        isaBalances.push_back(summary.isaBalance_);
-        giaBalances.push_back(summary.giaBalance_);
-        cryptoBalances.push_back(summary.cryptoBalance_);
-        totalInterests.push_back(summary.totalInterest_);
+        return appended;
     }
 
-    summaryPoints.emplace_back(dates, totalBalances);
-    summaryPoints.emplace_back(dates, currentBalances);
-    summaryPoints.emplace_back(dates, savingsBalances);
-    summaryPoints.emplace_back(dates, creditBalances);
-    summaryPoints.emplace_back(dates, isaBalances);
-    summaryPoints.emplace_back(dates, giaBalances);
-    summaryPoints.emplace_back(dates, cryptoBalances);
-    summaryPoints.emplace_back(dates, totalInterests);
+    std::string text;
+    for (const FinanceSummary &summary : summaries)
+    {
+        summary.WriteCSVRow(text);
+    }
 
-    return summaryPoints;
+    std::ofstream file("history.csv", std::ios::app | std::ios::binary);
+    if (!file.is_open())
+    {
+        std::cerr << "Error opening file" << std::endl;
+        return appended;
+    }
+    file << text;
+    file.close();
+    unwrittenCount_ -= std::min(unwrittenCount_, summaries.size());
+
+    historyOffset_ += static_cast<std::streamoff>(text.size());
+    historyTail_ = text.substr(text.rfind('\n', text.size() - 2) + 1);
+    return appended;
 }
 
-void SavedData::UpdateAccountsInCSV(std::vector<Account> accountList)
+void SavedData::AddSnapshot(const FinanceSummary &summary)
 {
-    std::ofstream file("accounts.csv");
+    savedSummaryList_.push_back(summary);
+    ++unwrittenCount_;
+    NotifyHistory({summary}, true);
+}
+
+void SavedData::AddHistoryObserver(HistoryObserver *observer)
+{
+    historyObservers_.push_back(observer);
+}
+
+void SavedData::RemoveHistoryObserver(HistoryObserver *observer)
+{
+    historyObservers_.erase(std::remove(historyObservers_.begin(), historyObservers_.end(), observer), historyObservers_.end());
+}
+
+void SavedData::NotifyHistory(const std::vector<FinanceSummary> &added, bool appended)
+{
+    for (HistoryObserver *observer : historyObservers_)
+    {
+        if (!appended)
+            observer->OnHistoryReset();
+        else if (!added.empty())
+            observer->OnSummariesAdded(added);
+    }
+}
+
+bool SavedData::UpdateAccountsInCSV(const std::vector<Account> &accountList)
+{
+    FileLock lock("accounts.csv", true);
+    if (FileStamp("accounts.csv") != accountsStamp_)
+    {
+        return false;
+    }
+
+    std::string text;
     for (const Account &account : accountList)
     {
-        file << account.name_ << "," << account.bank_ << "," << account.balance() << "," << account.interest() << "," << account.type_ << std::endl;
+        account.WriteCSVRow(text);
     }
+    std::ofstream file("accounts.csv");
+    file << text;
     file.close();
+    storedAccounts_ = accountList;
+    accountsStamp_ = FileStamp("accounts.csv");
+    return true;
 }
+
+const std::vector<Account> &SavedData::StoredAccounts() const { return storedAccounts_; }
+
+bool SavedData::AccountsFileChanged() const { return FileStamp("accounts.csv") != accountsStamp_; }
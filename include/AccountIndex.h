@@ -0,0 +1,183 @@
+#pragma once
+
+#include "Account.h"
+#include <cctype>
+
+// Position of an account field in Schema<Account>, which is also its grid column
+typedef size_t AccountKey;
+
+// Class holding ordered secondary indexes over an account list, keyed by position in the list.
+// There is one index per field of Schema<Account>, so a new field is indexed without changes here.
+class AccountIndex
+{
+private:
+    template <typename Fields>
+    struct IndexesOf;
+
+    // A set of (value, position) pairs for each field, in field order
+    template <typename... F>
+    struct IndexesOf<std::tuple<F...>>
+    {
+        typedef std::tuple<std::set<std::pair<typename F::Type, size_t>>...> Type;
+    };
+
+    typename IndexesOf<typename std::decay<decltype(Schema<Account>::fields_)>::type>::Type indexes_;
+
+    // Lower-cased bank, name and type of each account by position, so filtering needs no conversions
+    std::vector<std::string> searchKeys_;
+    static std::string SearchKey(const Account &account);
+
+    template <typename Set>
+    static void CollectIds(const Set &index, bool ascending, const std::vector<bool> *keep, std::vector<size_t> &ids);
+
+public:
+    // Rebuild every index from scratch
+    void Build(const std::vector<Account> &accountList);
+
+    // Add or remove a single account at position id
+    void Insert(size_t id, const Account &account);
+    void Erase(size_t id, const Account &account);
+
+    /**
+     * Move an edited account to its new place, touching only indexes whose key changed.
+     *
+     * @param id Position of the account in the account list.
+     * @param before Account as it is currently indexed.
+     * @param after Account after the edit.
+     */
+    void Update(size_t id, const Account &before, const Account &after);
+
+    /**
+     * List account positions in key order.
+     *
+     * @param key Field to order by.
+     * @param ascending Order direction.
+     * @param keep Flag per position saying whether it is listed, e.g. from Matching; null keeps everything.
+     * @param ids Output vector, overwritten with the ordered positions.
+     */
+    void Ordered(AccountKey key, bool ascending, const std::vector<bool> *keep, std::vector<size_t> &ids) const;
+
+    /**
+     * Flag the accounts whose bank, name or type contain some text, ignoring ASCII case.
+     *
+     * @param text Text to look for.
+     * @param matches Output vector, overwritten with a flag per account position.
+     */
+    void Matching(const std::string &text, std::vector<bool> &matches) const;
+
+    /**
+     * List positions of the accounts with a name, without visiting any other account.
+     *
+     * @param name Account name to look up.
+     * @param ids Output vector, overwritten with the positions in ascending order.
+     */
+    void Named(const std::string &name, std::vector<size_t> &ids) const;
+};
+
+// Implementation
+
+template <typename Set>
+void AccountIndex::CollectIds(const Set &index, bool ascending, const std::vector<bool> *keep, std::vector<size_t> &ids)
+{
+    if (ascending)
+    {
+        for (auto it = index.begin(); it != index.end(); ++it)
+            if (!keep || (*keep)[it->second])
+                ids.push_back(it->second);
+    }
+    else
+    {
+        for (auto it = index.rbegin(); it != index.rend(); ++it)
+            if (!keep || (*keep)[it->second])
+                ids.push_back(it->second);
+    }
+}
+
+std::string AccountIndex::SearchKey(const Account &account)
+{
+    // Separated by a newline, which a single-line filter never contains, so a match cannot span fields
+    std::string key = account.bank_ + '\n' + account.name_ + '\n' + account.type_;
+    for (char &c : key)
+    {
+        c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    }
+    return key;
+}
+
+void AccountIndex::Build(const std::vector<Account> &accountList)
+{
+    std::apply([](auto &...indexes)
+               { (indexes.clear(), ...); },
+               indexes_);
+    searchKeys_.clear();
+    for (size_t id = 0; id < accountList.size(); ++id)
+    {
+        Insert(id, accountList[id]);
+    }
+}
+
+void AccountIndex::Insert(size_t id, const Account &account)
+{
+    ForEachFieldIndexed<Account>([&](const auto &field, auto i)
+                                 { std::get<decltype(i)::value>(indexes_).emplace(account.*field.member_, id); });
+    if (searchKeys_.size() <= id)
+        searchKeys_.resize(id + 1);
+    searchKeys_[id] = SearchKey(account);
+}
+
+void AccountIndex::Erase(size_t id, const Account &account)
+{
+    ForEachFieldIndexed<Account>([&](const auto &field, auto i)
+                                 { std::get<decltype(i)::value>(indexes_).erase({account.*field.member_, id}); });
+    if (id + 1 == searchKeys_.size())
+        searchKeys_.pop_back();
+    else if (id < searchKeys_.size())
+        searchKeys_[id].clear();
+}
+
+void AccountIndex::Update(size_t id, const Account &before, const Account &after)
+{
+    ForEachFieldIndexed<Account>([&](const auto &field, auto i)
+                                 {
+                                     if (before.*field.member_ != after.*field.member_)
+                                     {
+                                         auto &index = std::get<decltype(i)::value>(indexes_);
+                                         index.erase({before.*field.member_, id});
+                                         index.emplace(after.*field.member_, id);
+                                     } });
+    if (before.bank_ != after.bank_ || before.name_ != after.name_ || before.type_ != after.type_)
+        searchKeys_[id] = SearchKey(after);
+}
+
+void AccountIndex::Ordered(AccountKey key, bool ascending, const std::vector<bool> *keep, std::vector<size_t> &ids) const
+{
+    ids.clear();
+    ForEachFieldIndexed<Account>([&](const auto &, auto i)
+                                 {
+                                     if (decltype(i)::value == key)
+                                         CollectIds(std::get<decltype(i)::value>(indexes_), ascending, keep, ids); });
+}
+
+void AccountIndex::Named(const std::string &name, std::vector<size_t> &ids) const
+{
+    ids.clear();
+    const auto &byName = std::get<FieldIndex<Account>("Name")>(indexes_);
+    for (auto it = byName.lower_bound({name, 0}); it != byName.end() && it->first == name; ++it)
+    {
+        ids.push_back(it->second);
+    }
+}
+
+void AccountIndex::Matching(const std::string &text, std::vector<bool> &matches) const
+{
+    std::string lower = text;
+    for (char &c : lower)
+    {
+        c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    }
+    matches.assign(searchKeys_.size(), false);
+    for (size_t id = 0; id < searchKeys_.size(); ++id)
+    {
+        matches[id] = searchKeys_[id].find(lower) != std::string::npos;
+    }
+}
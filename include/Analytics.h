@@ -0,0 +1,232 @@
+#pragma once
+
+#include "Account.h"
+#include <deque>
+#include <limits>
+
+// Class keeping statistics over the last few values of a series. Each push costs O(1)
+// amortised: the mean and variance follow Welford's update for adding and removing a value,
+// and the least squares slope comes from running sums. The drawdown scans the window, O(size).
+class RollingWindow
+{
+private:
+    size_t size_;
+    std::deque<double> values_;
+    double mean_;
+    double m2_;       // Sum of squared differences from the mean
+    double sumXY_;    // Sum of value * offset from the oldest value in the window, for the slope
+
+public:
+    // Constructor to create an empty window over the given number of values
+    RollingWindow(size_t size);
+
+    void Push(double value);
+    void Clear();
+
+    size_t Count() const;
+    double Oldest() const;
+    double Newest() const;
+    double Mean() const;
+    // Sample variance, 0 with fewer than two values
+    double Variance() const;
+    double StdDev() const;
+    // Least squares slope of the values against their position, per step
+    double Slope() const;
+    // Largest fall from a value to a later one in the window, as a fraction of the earlier value
+    // when it is positive. O(size) per call, which for the snapshot windows used is a few dozen
+    // values; keeping it to O(1) would need the peak before every trough tracked as peaks expire.
+    double MaxDrawdown() const;
+};
+
+// Metrics derived from the history at one snapshot, each over the trailing window
+struct AnalyticsPoint
+{
+    double growth_;            // Change in net worth since the start of the window, in percent
+    double savingsRate_;       // Mean share of net worth held in Savings and ISA accounts, in percent
+    double utilisationTrend_;  // Slope of credit balances as a percentage of assets, in points per snapshot
+    double volatility_;        // Standard deviation of snapshot-to-snapshot investment returns, in percent
+    double maxDrawdown_;       // Largest fall of investments from a peak within the window, in percent
+};
+
+// Analytics plotted as series, in percent
+template <>
+struct Schema<AnalyticsPoint>
+{
+    static constexpr auto fields_ = std::make_tuple(
+        MakeField("Growth", &AnalyticsPoint::growth_, "Net Worth Growth"),
+        MakeField("Savings Rate", &AnalyticsPoint::savingsRate_),
+        MakeField("Credit Utilisation Trend", &AnalyticsPoint::utilisationTrend_),
+        MakeField("Volatility", &AnalyticsPoint::volatility_, "Investment Volatility"),
+        MakeField("Max Drawdown", &AnalyticsPoint::maxDrawdown_, "Investment Max Drawdown"));
+    static constexpr size_t required_ = 5;
+};
+
+// Class deriving rolling metrics from summary snapshots as they are added to the history.
+// Investments are GIA and Crypto balances, as in the "Invested" liquidity tier.
+class AnalyticsEngine
+{
+private:
+    size_t window_;
+    RollingWindow totals_;
+    RollingWindow savingsShares_;
+    RollingWindow utilisation_;
+    RollingWindow returns_;
+    RollingWindow investments_;
+    double lastInvestments_;
+    bool hasLast_;
+
+public:
+    /**
+     * Constructor to create an engine with no snapshots.
+     *
+     * @param window Number of snapshots each metric looks back over.
+     */
+    AnalyticsEngine(size_t window = 12);
+
+    // Change the window, forgetting all snapshots so they can be added again
+    void SetWindow(size_t window);
+    size_t Window() const;
+    void Reset();
+
+    /**
+     * Add the next snapshot in history order.
+     *
+     * @param summary Snapshot, in the currency the metrics should be computed in.
+     * @return Metrics as of this snapshot.
+     */
+    AnalyticsPoint Add(const FinanceSummary &summary);
+};
+
+// Implementation
+
+// Rolling Window
+RollingWindow::RollingWindow(size_t size)
+    : size_(size > 0 ? size : 1)
+{
+    Clear();
+}
+
+void RollingWindow::Clear()
+{
+    values_.clear();
+    mean_ = 0;
+    m2_ = 0;
+    sumXY_ = 0;
+}
+
+void RollingWindow::Push(double value)
+{
+    sumXY_ += static_cast<double>(values_.size()) * value;
+    values_.push_back(value);
+    double delta = value - mean_;
+    mean_ += delta / static_cast<double>(values_.size());
+    m2_ += delta * (value - mean_);
+
+    if (values_.size() > size_)
+    {
+        // Reverse Welford's update for the value leaving the window
+        double oldest = values_.front();
+        values_.pop_front();
+        double oldDelta = oldest - mean_;
+        mean_ -= oldDelta / static_cast<double>(values_.size());
+        m2_ -= oldDelta * (oldest - mean_);
+        // Offsets are from the oldest value, so every remaining offset drops by one
+        sumXY_ -= mean_ * static_cast<double>(values_.size());
+    }
+}
+
+size_t RollingWindow::Count() const { return values_.size(); }
+
+double RollingWindow::Oldest() const { return values_.empty() ? 0 : values_.front(); }
+
+double RollingWindow::Newest() const { return values_.empty() ? 0 : values_.back(); }
+
+double RollingWindow::Mean() const { return mean_; }
+
+double RollingWindow::Variance() const
+{
+    // Removals can leave m2_ a rounding error below zero
+    return values_.size() > 1 ? std::max(m2_, 0.0) / static_cast<double>(values_.size() - 1) : 0;
+}
+
+double RollingWindow::StdDev() const { return std::sqrt(Variance()); }
+
+double RollingWindow::Slope() const
+{
+    double n = static_cast<double>(values_.size());
+    if (values_.size() < 2)
+        return 0;
+
+    // Offsets are 0 to n - 1, so their mean and spread follow from the count
+    double meanX = (n - 1) / 2;
+    double varianceX = (n * n - 1) / 12;
+    return (sumXY_ / n - meanX * mean_) / varianceX;
+}
+
+double RollingWindow::MaxDrawdown() const
+{
+    double peak = std::numeric_limits<double>::lowest();
+    double drawdown = 0;
+    for (double value : values_)
+    {
+        peak = std::max(peak, value);
+        if (peak > 0)
+            drawdown = std::max(drawdown, (peak - value) / peak);
+    }
+    return drawdown;
+}
+
+// Analytics Engine
+AnalyticsEngine::AnalyticsEngine(size_t window)
+    : window_(window > 0 ? window : 1),
+      totals_(window_), savingsShares_(window_), utilisation_(window_),
+      returns_(window_), investments_(window_),
+      lastInvestments_(0), hasLast_(false)
+{
+}
+
+void AnalyticsEngine::SetWindow(size_t window)
+{
+    *this = AnalyticsEngine(window);
+}
+
+size_t AnalyticsEngine::Window() const { return window_; }
+
+void AnalyticsEngine::Reset()
+{
+    SetWindow(window_);
+}
+
+AnalyticsPoint AnalyticsEngine::Add(const FinanceSummary &summary)
+{
+    AnalyticsPoint point;
+    double total = summary.totalBalance_;
+
+    // Growth against the oldest snapshot still in the window, which is this one until it fills
+    totals_.Push(total);
+    double start = totals_.Oldest();
+    point.growth_ = start != 0 ? (total - start) / std::fabs(start) * 100 : 0;
+
+    savingsShares_.Push(total != 0 ? (summary.savingsBalance_ + summary.isaBalance_) / total * 100 : 0);
+    point.savingsRate_ = savingsShares_.Mean();
+
+    // Credit balances are negative, assets are everything else
+    double assets = total - summary.creditBalance_;
+    utilisation_.Push(assets > 0 ? std::fabs(summary.creditBalance_) / assets * 100 : 0);
+    point.utilisationTrend_ = utilisation_.Slope();
+
+    double investments = summary.giaBalance_ + summary.cryptoBalance_;
+    if (hasLast_ && lastInvestments_ > 0)
+    {
+        returns_.Push((investments / lastInvestments_ - 1) * 100);
+    }
+    point.volatility_ = returns_.StdDev();
+    lastInvestments_ = investments;
+    hasLast_ = true;
+
+    // Peak and trough both lie within the window
+    investments_.Push(investments);
+    point.maxDrawdown_ = investments_.MaxDrawdown() * 100;
+
+    return point;
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <string>
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <ctime>
+
+// Dates are handled as days since 1970-01-01 (UTC), whole days unless a time of day is kept
+
+// Convert a calendar date to a day number
+int DaysFromCivil(int year, unsigned month, unsigned day);
+
+// Convert a day number back to a calendar date
+void CivilFromDays(int days, int &year, unsigned &month, unsigned &day);
+
+// Parse a "YYYY-MM-DD" date, returning false if it is malformed
+bool ParseISODate(const std::string &text, int &days);
+
+// Parse a history date as written by asctime, e.g. "Mon Oct 19 15:09:06 2026", dropping the time
+bool ParseSummaryDate(const std::string &text, int &days);
+
+// As above, keeping the time of day as a fraction of the day
+bool ParseSummaryDate(const std::string &text, double &days);
+
+// Day number of the current UTC date
+int Today();
+
+// Implementation
+
+int DaysFromCivil(int year, unsigned month, unsigned day)
+{
+    year -= month <= 2;
+    const int era = (year >= 0 ? year : year - 399) / 400;
+    const unsigned yoe = static_cast<unsigned>(year - era * 400);
+    const unsigned doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + static_cast<int>(doe) - 719468;
+}
+
+void CivilFromDays(int days, int &year, unsigned &month, unsigned &day)
+{
+    days += 719468;
+    const int era = (days >= 0 ? days : days - 146096) / 146097;
+    const unsigned doe = static_cast<unsigned>(days - era * 146097);
+    const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const unsigned mp = (5 * doy + 2) / 153;
+    day = doy - (153 * mp + 2) / 5 + 1;
+    month = mp < 10 ? mp + 3 : mp - 9;
+    year = static_cast<int>(yoe) + era * 400 + (month <= 2);
+}
+
+bool ParseISODate(const std::string &text, int &days)
+{
+    int year;
+    unsigned month, day;
+    if (std::sscanf(text.c_str(), "%d-%u-%u", &year, &month, &day) != 3 ||
+        month < 1 || month > 12 || day < 1 || day > 31)
+    {
+        return false;
+    }
+    days = DaysFromCivil(year, month, day);
+    return true;
+}
+
+bool ParseSummaryDate(const std::string &text, int &days)
+{
+    double time;
+    if (!ParseSummaryDate(text, time))
+    {
+        return false;
+    }
+    days = static_cast<int>(std::floor(time));
+    return true;
+}
+
+bool ParseSummaryDate(const std::string &text, double &days)
+{
+    static const char *months[] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun",
+                                   "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+    char monthName[4] = {0};
+    unsigned day, hours, minutes, seconds;
+    int year;
+    if (std::sscanf(text.c_str(), "%*3s %3s %u %u:%u:%u %d", monthName, &day, &hours, &minutes, &seconds, &year) != 6 ||
+        hours > 23 || minutes > 59 || seconds > 60)
+    {
+        return false;
+    }
+    for (unsigned month = 0; month < 12; ++month)
+    {
+        if (std::strcmp(monthName, months[month]) == 0)
+        {
+            days = DaysFromCivil(year, month + 1, day) + (hours * 3600 + minutes * 60 + seconds) / 86400.0;
+            return true;
+        }
+    }
+    return false;
+}
+
+int Today()
+{
+    return static_cast<int>(time(0) / 86400);
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <string>
+#include <iostream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+
+// Class holding an advisory lock on a data file for its lifetime, so external writers that
+// also use flock() never interleave with the application's reads and writes
+class FileLock
+{
+private:
+    int fd_;
+
+public:
+    /**
+     * Constructor to block until the lock is acquired, creating the file if it is missing.
+     *
+     * @param path File to lock.
+     * @param exclusive True to lock for writing, false to share the lock with other readers.
+     */
+    FileLock(const std::string &path, bool exclusive);
+    ~FileLock();
+
+    FileLock(const FileLock &) = delete;
+    FileLock &operator=(const FileLock &) = delete;
+};
+
+// What stat can tell about a file's contents, to notice when another writer has changed it
+class FileStamp
+{
+private:
+    ino_t inode_;
+    off_t size_;
+    time_t modified_;
+    long modifiedNs_;
+
+public:
+    // Constructor to stamp the file as it is now; a missing file has a stamp of its own
+    FileStamp(const std::string &path = "");
+
+    bool operator==(const FileStamp &other) const;
+    bool operator!=(const FileStamp &other) const;
+};
+
+// Implementation
+
+FileLock::FileLock(const std::string &path, bool exclusive)
+    : fd_(open(path.c_str(), O_RDONLY | O_CREAT, 0644))
+{
+    // Read-only is enough for flock, and closing it does not look like a write to file watchers
+    if (fd_ < 0)
+    {
+        std::cerr << "Error opening " << path << " for locking" << std::endl;
+        return;
+    }
+    if (flock(fd_, exclusive ? LOCK_EX : LOCK_SH) != 0)
+    {
+        std::cerr << "Error locking " << path << std::endl;
+    }
+}
+
+FileLock::~FileLock()
+{
+    if (fd_ >= 0)
+    {
+        flock(fd_, LOCK_UN);
+        close(fd_);
+    }
+}
+
+FileStamp::FileStamp(const std::string &path)
+    : inode_(0), size_(-1), modified_(0), modifiedNs_(0)
+{
+    struct stat info;
+    if (!path.empty() && stat(path.c_str(), &info) == 0)
+    {
+        inode_ = info.st_ino;
+        size_ = info.st_size;
+        modified_ = info.st_mtime;
+#ifdef __linux__
+        // Two writes within a second of each other often leave the same size
+        modifiedNs_ = info.st_mtim.tv_nsec;
+#endif
+    }
+}
+
+bool FileStamp::operator==(const FileStamp &other) const
+{
+    return inode_ == other.inode_ && size_ == other.size_ && modified_ == other.modified_ && modifiedNs_ == other.modifiedNs_;
+}
+
+bool FileStamp::operator!=(const FileStamp &other) const { return !(*this == other); }
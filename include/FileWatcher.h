@@ -0,0 +1,120 @@
+#pragma once
+
+#include <string>
+#include <set>
+#include <map>
+#include <iostream>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <climits>
+#endif
+
+// Class reporting changes to files in the working directory. Uses inotify on Linux, where
+// Poll only drains already queued events, and falls back to comparing file stats elsewhere.
+class FileWatcher
+{
+private:
+    std::set<std::string> names_;
+#ifdef __linux__
+    int fd_;
+#else
+    std::map<std::string, std::pair<time_t, off_t>> stats_;
+#endif
+
+public:
+    // Constructor to start watching the given file names
+    FileWatcher(const std::set<std::string> &names);
+    ~FileWatcher();
+
+    FileWatcher(const FileWatcher &) = delete;
+    FileWatcher &operator=(const FileWatcher &) = delete;
+
+    /**
+     * Collect watched files changed since the last poll, without blocking.
+     *
+     * @return Names of changed files, each reported once however many events it produced.
+     */
+    std::set<std::string> Poll();
+};
+
+// Implementation
+
+#ifdef __linux__
+
+FileWatcher::FileWatcher(const std::set<std::string> &names)
+    : names_(names), fd_(inotify_init1(IN_NONBLOCK | IN_CLOEXEC))
+{
+    // Watch the directory rather than the files, so replacing a file by rename is still seen
+    if (fd_ < 0 || inotify_add_watch(fd_, ".", IN_MODIFY | IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) < 0)
+    {
+        std::cerr << "Error watching data files" << std::endl;
+    }
+}
+
+FileWatcher::~FileWatcher()
+{
+    if (fd_ >= 0)
+    {
+        close(fd_);
+    }
+}
+
+std::set<std::string> FileWatcher::Poll()
+{
+    std::set<std::string> changed;
+    if (fd_ < 0)
+    {
+        return changed;
+    }
+
+    alignas(inotify_event) char buffer[16 * (sizeof(inotify_event) + NAME_MAX + 1)];
+    ssize_t length;
+    while ((length = read(fd_, buffer, sizeof(buffer))) > 0)
+    {
+        for (char *ptr = buffer; ptr < buffer + length;)
+        {
+            const inotify_event *event = reinterpret_cast<const inotify_event *>(ptr);
+            if (event->len > 0 && names_.count(event->name))
+            {
+                changed.insert(event->name);
+            }
+            ptr += sizeof(inotify_event) + event->len;
+        }
+    }
+    return changed;
+}
+
+#else
+
+FileWatcher::FileWatcher(const std::set<std::string> &names)
+    : names_(names)
+{
+    Poll();
+}
+
+FileWatcher::~FileWatcher() {}
+
+std::set<std::string> FileWatcher::Poll()
+{
+    std::set<std::string> changed;
+    for (const std::string &name : names_)
+    {
+        struct stat info;
+        std::pair<time_t, off_t> current(0, 0);
+        if (stat(name.c_str(), &info) == 0)
+        {
+            current = std::make_pair(info.st_mtime, info.st_size);
+        }
+        auto previous = stats_.find(name);
+        if (previous != stats_.end() && previous->second != current)
+        {
+            changed.insert(name);
+        }
+        stats_[name] = current;
+    }
+    return changed;
+}
+
+#endif
@@ -0,0 +1,308 @@
+#pragma once
+
+#include "Account.h"
+#include <climits>
+#include <unordered_map>
+
+// How often a recurring transaction repeats
+enum Frequency
+{
+    Frequency_Daily,
+    Frequency_Weekly,
+    Frequency_Monthly,
+    Frequency_Yearly
+};
+
+// Class representing a recurring transaction such as a salary, direct debit or transfer
+class RecurrenceRule
+{
+public:
+    std::string description_;
+    std::string account_;  // Name of the account the amount is applied to
+    std::string target_;   // For transfers, name of the account receiving the amount, otherwise empty
+    double amount_;        // In the currency of account_, negative for payments out
+    Frequency frequency_;
+    int interval_;         // Repeat every interval_ days, weeks, months or years
+    int start_;            // Day number of the first occurrence
+    int end_;              // Day number after which the rule stops
+
+    RecurrenceRule(const std::string &description, const std::string &account, double amount, Frequency frequency,
+                   int interval, int start, int end = INT_MAX, const std::string &target = "");
+
+    // Day number of the n-th occurrence, counting from 0
+    int Occurrence(int n) const;
+};
+
+// Daily forecast series, one value per day from startDay_
+class Forecast
+{
+public:
+    int startDay_;
+    // Series names, "Total" followed by each account type summed in FinanceSummary
+    std::vector<std::string> names_;
+    std::vector<std::vector<double>> series_;
+
+    Forecast();
+    bool IsEmpty() const;
+};
+
+// Class expanding recurring transactions into future balances
+class ForecastEngine
+{
+private:
+    std::vector<RecurrenceRule> rules_;
+
+public:
+    /**
+     * Load rules from the recurring CSV file.
+     *
+     * Each line is "description,account,amount,frequency,interval,start[,end[,target]]" with
+     * frequency one of Daily, Weekly, Monthly or Yearly and dates as YYYY-MM-DD.
+     */
+    void LoadRulesFromCSV(const std::string &path = "recurring.csv");
+
+    void AddRule(const RecurrenceRule &rule);
+    const std::vector<RecurrenceRule> &Rules() const;
+
+    /**
+     * Simulate balances day by day.
+     *
+     * Occurrences are generated lazily: a calendar queue holds only the next occurrence of each
+     * rule. Events apply to per-account balances, and each change is carried into the total and
+     * per-type series as it applies, so each day costs the events falling on it plus one value
+     * per series.
+     *
+     * @param accountList Accounts holding the starting balances.
+     * @param rates Exchange rates to convert account currencies with, at today's rate.
+     * @param currency Currency to express the series in.
+     * @param startDay Day number of the first forecast day.
+     * @param days Number of days to forecast.
+     * @return Total and per-type balance series.
+     */
+    Forecast Run(const std::vector<Account> &accountList, const FxRates &rates, const std::string &currency, int startDay, int days) const;
+};
+
+// Implementation
+
+RecurrenceRule::RecurrenceRule(const std::string &description, const std::string &account, double amount, Frequency frequency,
+                               int interval, int start, int end, const std::string &target)
+    : description_(description), account_(account), target_(target), amount_(amount), frequency_(frequency),
+      interval_(interval > 0 ? interval : 1), start_(start), end_(end)
+{
+}
+
+int RecurrenceRule::Occurrence(int n) const
+{
+    switch (frequency_)
+    {
+    case Frequency_Daily:
+        return start_ + n * interval_;
+    case Frequency_Weekly:
+        return start_ + n * interval_ * 7;
+    case Frequency_Monthly:
+    case Frequency_Yearly:
+    {
+        // Step from the start date each time so a 31st clamps to short months without drifting
+        int year;
+        unsigned month, day;
+        CivilFromDays(start_, year, month, day);
+        int months = static_cast<int>(month) - 1 + n * interval_ * (frequency_ == Frequency_Yearly ? 12 : 1);
+        year += months / 12;
+        month = static_cast<unsigned>(months % 12) + 1;
+        static const unsigned monthDays[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+        bool leap = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+        unsigned lastDay = monthDays[month - 1] + (month == 2 && leap ? 1 : 0);
+        return DaysFromCivil(year, month, std::min(day, lastDay));
+    }
+    }
+    return INT_MAX;
+}
+
+Forecast::Forecast()
+    : startDay_(0)
+{
+}
+
+bool Forecast::IsEmpty() const { return series_.empty() || series_[0].empty(); }
+
+void ForecastEngine::LoadRulesFromCSV(const std::string &path)
+{
+    rules_.clear();
+    std::ifstream file(path);
+    if (!file.is_open())
+    {
+        return;
+    }
+    static const std::map<std::string, Frequency> frequencies = {
+        {"Daily", Frequency_Daily}, {"Weekly", Frequency_Weekly}, {"Monthly", Frequency_Monthly}, {"Yearly", Frequency_Yearly}};
+    std::string line;
+
+    while (std::getline(file, line))
+    {
+        std::istringstream ss(line);
+        std::string description, account, frequency, start, end, target;
+        double amount;
+        int interval, startDay, endDay = INT_MAX;
+        if (std::getline(ss, description, ',') &&
+            std::getline(ss, account, ',') &&
+            ss >> amount &&
+            ss.ignore() &&
+            std::getline(ss, frequency, ',') &&
+            ss >> interval &&
+            ss.ignore() &&
+            std::getline(ss, start, ',') &&
+            ParseISODate(start, startDay) &&
+            frequencies.count(frequency))
+        {
+            if (std::getline(ss, end, ',') && !end.empty() && !ParseISODate(end, endDay))
+            {
+                std::cerr << "Invalid end date for " << description << std::endl;
+                continue;
+            }
+            std::getline(ss, target);
+            rules_.push_back(RecurrenceRule(description, account, amount, frequencies.at(frequency), interval, startDay, endDay, target));
+        }
+    }
+}
+
+void ForecastEngine::AddRule(const RecurrenceRule &rule) { rules_.push_back(rule); }
+
+const std::vector<RecurrenceRule> &ForecastEngine::Rules() const { return rules_; }
+
+Forecast ForecastEngine::Run(const std::vector<Account> &accountList, const FxRates &rates, const std::string &currency, int startDay, int days) const
+{
+    days = std::max(days, 0);
+
+    // Per-type series follow the summary balances that sum an account type
+    std::vector<std::string> types;
+    ForEachNumericField<FinanceSummary>([&](const auto &field)
+                                        {
+                                            if (field.accountType_)
+                                                types.push_back(field.accountType_); });
+
+    // Per-account balance, conversion factor and series slot, so an event is a few additions
+    std::unordered_map<std::string, size_t> accountIds;
+    std::vector<double> balances(accountList.size());
+    std::vector<double> factors(accountList.size());
+    std::vector<int> typeSlots(accountList.size(), -1);
+    std::vector<double> totals(types.size() + 1, 0);
+    int today = Today();
+    for (size_t id = 0; id < accountList.size(); ++id)
+    {
+        const Account &account = accountList[id];
+        accountIds.emplace(account.name_, id);
+        balances[id] = account.balance();
+        factors[id] = rates.Rate(account.currency_, currency, today);
+        for (size_t type = 0; type < types.size(); ++type)
+        {
+            if (account.type_ == types[type])
+                typeSlots[id] = static_cast<int>(type) + 1;
+        }
+        totals[0] += balances[id] * factors[id];
+        if (typeSlots[id] > 0)
+            totals[typeSlots[id]] += balances[id] * factors[id];
+    }
+
+    // Effect of one occurrence of each rule on up to two accounts, in their own currencies
+    struct Effect
+    {
+        int accounts_[2] = {-1, -1};
+        double amounts_[2] = {0, 0};
+    };
+    std::vector<Effect> effects(rules_.size());
+
+    // Calendar queue with a bucket per forecast day, holding (rule, occurrence number) of each
+    // rule's next occurrence only, so scheduling and popping an event are constant time
+    std::vector<std::vector<std::pair<size_t, int>>> calendar(days);
+    for (size_t i = 0; i < rules_.size(); ++i)
+    {
+        const RecurrenceRule &rule = rules_[i];
+        auto account = accountIds.find(rule.account_);
+        if (account == accountIds.end())
+        {
+            std::cerr << "Unknown account " << rule.account_ << " in " << rule.description_ << std::endl;
+            continue;
+        }
+        size_t from = account->second;
+        Effect effect;
+        effect.accounts_[0] = static_cast<int>(from);
+        effect.amounts_[0] = rule.amount_;
+        if (!rule.target_.empty())
+        {
+            auto target = accountIds.find(rule.target_);
+            if (target == accountIds.end())
+            {
+                std::cerr << "Unknown account " << rule.target_ << " in " << rule.description_ << std::endl;
+                continue;
+            }
+            // A transfer leaves one account and arrives in the other, converted to its currency
+            size_t to = target->second;
+            if (!rates.Converts(accountList[from].currency_, accountList[to].currency_))
+            {
+                std::cerr << "No exchange rate between the accounts in " << rule.description_ << std::endl;
+                continue;
+            }
+            effect.accounts_[1] = static_cast<int>(to);
+            effect.amounts_[1] = -rule.amount_ * rates.Rate(accountList[from].currency_, accountList[to].currency_, today);
+        }
+        effects[i] = effect;
+
+        // Skip occurrences before the forecast starts; these are already in today's balances
+        int n = 0;
+        if (rule.frequency_ == Frequency_Daily || rule.frequency_ == Frequency_Weekly)
+        {
+            int step = rule.interval_ * (rule.frequency_ == Frequency_Weekly ? 7 : 1);
+            n = rule.start_ < startDay ? (startDay - rule.start_ + step - 1) / step : 0;
+        }
+        else
+        {
+            while (rule.Occurrence(n) < startDay)
+                ++n;
+        }
+        int day = rule.Occurrence(n);
+        if (day <= rule.end_ && day < startDay + days)
+            calendar[day - startDay].emplace_back(i, n);
+    }
+
+    Forecast forecast;
+    forecast.startDay_ = startDay;
+    forecast.names_.push_back("Total");
+    forecast.names_.insert(forecast.names_.end(), types.begin(), types.end());
+    forecast.series_.assign(totals.size(), std::vector<double>());
+    for (std::vector<double> &series : forecast.series_)
+    {
+        series.reserve(days);
+    }
+
+    for (int offset = 0; offset < days; ++offset)
+    {
+        for (const std::pair<size_t, int> &event : calendar[offset])
+        {
+            const RecurrenceRule &rule = rules_[event.first];
+            const Effect &effect = effects[event.first];
+            for (int k = 0; k < 2; ++k)
+            {
+                int id = effect.accounts_[k];
+                if (id < 0)
+                    continue;
+                balances[id] += effect.amounts_[k];
+                double converted = effect.amounts_[k] * factors[id];
+                totals[0] += converted;
+                if (typeSlots[id] > 0)
+                    totals[typeSlots[id]] += converted;
+            }
+
+            int next = event.second + 1;
+            int nextDay = rule.Occurrence(next);
+            if (nextDay <= rule.end_ && nextDay < startDay + days)
+                calendar[nextDay - startDay].emplace_back(event.first, next);
+        }
+        std::vector<std::pair<size_t, int>>().swap(calendar[offset]);
+
+        for (size_t s = 0; s < totals.size(); ++s)
+        {
+            forecast.series_[s].push_back(totals[s]);
+        }
+    }
+    return forecast;
+}
@@ -0,0 +1,152 @@
+#pragma once
+
+#include "Dates.h"
+#include <map>
+#include <unordered_map>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <set>
+#include <iterator>
+
+// Class holding dated exchange rates, each quoted as the value of one unit in the pivot currency
+class FxRates
+{
+private:
+    // currency -> (day -> rate)
+    std::map<std::string, std::map<int, double>> rates_;
+    // currency -> (day -> rate in effect on that day), filled on lookup
+    mutable std::unordered_map<std::string, std::unordered_map<int, double>> cache_;
+    // Currencies already reported as having no rates
+    mutable std::set<std::string> missing_;
+
+    // Rate of currency against the pivot on a day
+    double PivotRate(const std::string &currency, int day) const;
+
+public:
+    // Currency every rate in the rates file is quoted in
+    static const std::string pivot_;
+
+    /**
+     * Load rates from the rates CSV file.
+     *
+     * Each line is "YYYY-MM-DD,CCY,rate" where rate is the value of one CCY in the pivot currency.
+     * A missing file leaves only the pivot currency available.
+     */
+    void LoadFromCSV(const std::string &path = "rates.csv");
+
+    // Add a single dated rate, clearing cached lookups
+    void SetRate(const std::string &currency, int day, double rate);
+
+    // True if the currency is the pivot or has at least one rate
+    bool Known(const std::string &currency) const;
+
+    // True if amounts in one currency can be converted to another
+    bool Converts(const std::string &from, const std::string &to) const;
+
+    /**
+     * Rate converting an amount in one currency to another on a day.
+     *
+     * Uses the latest rate on or before the day, or the earliest known rate for earlier days.
+     * Currencies without rates are reported once and give a rate of 0, so amounts that cannot be
+     * converted are left out of converted totals rather than counted at par.
+     *
+     * @param from Currency of the amount.
+     * @param to Currency to convert to.
+     * @param day Day number of the valuation date.
+     * @return Multiplier taking an amount in from to an amount in to.
+     */
+    double Rate(const std::string &from, const std::string &to, int day) const;
+};
+
+// Implementation
+
+const std::string FxRates::pivot_ = "GBP";
+
+void FxRates::LoadFromCSV(const std::string &path)
+{
+    std::ifstream file(path);
+    if (!file.is_open())
+    {
+        return;
+    }
+    std::string line;
+
+    while (std::getline(file, line))
+    {
+        std::istringstream ss(line);
+        std::string date, currency;
+        double rate;
+        int day;
+        if (std::getline(ss, date, ',') &&
+            std::getline(ss, currency, ',') &&
+            ss >> rate &&
+            ParseISODate(date, day) &&
+            rate > 0)
+        {
+            rates_[currency][day] = rate;
+        }
+    }
+    cache_.clear();
+}
+
+void FxRates::SetRate(const std::string &currency, int day, double rate)
+{
+    rates_[currency][day] = rate;
+    cache_.clear();
+}
+
+double FxRates::PivotRate(const std::string &currency, int day) const
+{
+    if (currency == pivot_)
+    {
+        return 1;
+    }
+
+    auto &cachedDays = cache_[currency];
+    auto cached = cachedDays.find(day);
+    if (cached != cachedDays.end())
+    {
+        return cached->second;
+    }
+
+    double rate = 0;
+    auto found = rates_.find(currency);
+    if (found == rates_.end() || found->second.empty())
+    {
+        if (missing_.insert(currency).second)
+        {
+            std::cerr << "No exchange rate for " << currency << std::endl;
+        }
+    }
+    else
+    {
+        const std::map<int, double> &dated = found->second;
+        auto next = dated.upper_bound(day);
+        rate = (next == dated.begin()) ? next->second : std::prev(next)->second;
+    }
+    cachedDays.emplace(day, rate);
+    return rate;
+}
+
+bool FxRates::Known(const std::string &currency) const
+{
+    auto found = rates_.find(currency);
+    return currency == pivot_ || (found != rates_.end() && !found->second.empty());
+}
+
+bool FxRates::Converts(const std::string &from, const std::string &to) const
+{
+    return from == to || (Known(from) && Known(to));
+}
+
+double FxRates::Rate(const std::string &from, const std::string &to, int day) const
+{
+    if (from == to)
+    {
+        return 1;
+    }
+    double fromRate = PivotRate(from, day);
+    double toRate = PivotRate(to, day);
+    return fromRate != 0 && toRate != 0 ? fromRate / toRate : 0;
+}
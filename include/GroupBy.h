@@ -0,0 +1,312 @@
+#pragma once
+
+#include "Account.h"
+#include <unordered_map>
+
+// Account attributes accounts can be grouped by
+enum GroupKey
+{
+    Group_Type,
+    Group_Bank,
+    Group_Currency,
+    Group_Owner,
+    Group_Tag,
+    Group_Liquidity,
+    Group_Count
+};
+
+// Totals for one group, converted to the base currency
+struct GroupResult
+{
+    std::string name_;     // e.g. "Bank/Monzo"
+    double balance_;       // Sum of balances
+    double interest_;      // Annual interest earned, as in FinanceSummary::totalInterest_
+    double interestRate_;  // Balance-weighted interest rate in percent
+    size_t accounts_;
+};
+
+// Class aggregating accounts over configurable groupings. Totals are kept per group and per
+// currency, so an edit only touches the groups of the edited account, and converted results
+// are cached per group until one of its accounts changes.
+class GroupByEngine
+{
+private:
+    struct Partial
+    {
+        double balance_ = 0;
+        double weightedInterest_ = 0; // Sum of balance * interest rate
+    };
+
+    struct Group
+    {
+        std::unordered_map<std::string, Partial> byCurrency_;
+        size_t accounts_ = 0;
+        bool valid_ = false;
+        GroupResult result_;
+    };
+
+    std::vector<GroupKey> keys_;
+    // Groups of every configured key, by "Key/value" name
+    std::unordered_map<std::string, Group> groups_;
+    // Currency and valuation day the cached results were converted with
+    std::string resultCurrency_;
+    int resultDay_;
+
+    // Names of the groups an account belongs to under the configured keys
+    std::vector<std::string> GroupsOf(const Account &account) const;
+    void Apply(const Account &account, double sign);
+
+public:
+    GroupByEngine();
+
+    static const char *KeyName(GroupKey key);
+
+    // Liquidity tier of an account type, from cash to liabilities
+    static std::string LiquidityTier(const std::string &type);
+
+    /**
+     * Choose the groupings to compute and aggregate all accounts in one pass.
+     *
+     * @param keys Groupings to compute.
+     * @param accountList Accounts to aggregate.
+     */
+    void Configure(const std::vector<GroupKey> &keys, const std::vector<Account> &accountList);
+    const std::vector<GroupKey> &Keys() const;
+
+    /**
+     * Read the groupings chosen in an earlier session from the groups config file.
+     *
+     * The file holds the key names on one line separated by commas, e.g. "Type,Bank". Unknown
+     * names are skipped, and a missing file means no groupings.
+     */
+    static std::vector<GroupKey> LoadKeys(const std::string &path = "groups.cfg");
+
+    // Write the configured groupings to the groups config file
+    void SaveKeys(const std::string &path = "groups.cfg") const;
+
+    // Incrementally account for an added, removed or edited account
+    void Add(const Account &account);
+    void Remove(const Account &account);
+    void Update(const Account &before, const Account &after);
+
+    /**
+     * Totals of every group, converting only groups changed since the last call.
+     *
+     * @param rates Exchange rates to convert with.
+     * @param currency Currency to express the totals in.
+     * @return Results ordered by group name.
+     */
+    std::vector<GroupResult> Results(const FxRates &rates, const std::string &currency);
+
+    // Group balances in the form stored with history snapshots
+    std::map<std::string, double> Totals(const FxRates &rates, const std::string &currency);
+};
+
+// Implementation
+
+GroupByEngine::GroupByEngine()
+    : resultDay_(0)
+{
+}
+
+const char *GroupByEngine::KeyName(GroupKey key)
+{
+    static const char *names[] = {"Type", "Bank", "Currency", "Owner", "Tag", "Liquidity"};
+    return (key >= 0 && key < Group_Count) ? names[key] : "";
+}
+
+std::vector<GroupKey> GroupByEngine::LoadKeys(const std::string &path)
+{
+    std::vector<GroupKey> keys;
+    std::ifstream file(path);
+    std::string line, name;
+    if (!file.is_open() || !std::getline(file, line))
+    {
+        return keys;
+    }
+
+    std::istringstream ss(line);
+    while (std::getline(ss, name, ','))
+    {
+        int key = 0;
+        while (key < Group_Count && name != KeyName(static_cast<GroupKey>(key)))
+            ++key;
+        if (key < Group_Count)
+            keys.push_back(static_cast<GroupKey>(key));
+        else if (!name.empty())
+            std::cerr << "Unknown grouping " << name << " in " << path << std::endl;
+    }
+    return keys;
+}
+
+void GroupByEngine::SaveKeys(const std::string &path) const
+{
+    std::ofstream file(path);
+    if (!file.is_open())
+    {
+        std::cerr << "Error opening " << path << std::endl;
+        return;
+    }
+    for (size_t i = 0; i < keys_.size(); ++i)
+    {
+        file << (i > 0 ? "," : "") << KeyName(keys_[i]);
+    }
+    file << '\n';
+}
+
+std::string GroupByEngine::LiquidityTier(const std::string &type)
+{
+    if (type == "Current")
+        return "Instant";
+    if (type == "Savings" || type == "ISA")
+        return "Easy Access";
+    if (type == "GIA" || type == "Crypto")
+        return "Invested";
+    if (type == "Credit")
+        return "Liability";
+    return "Other";
+}
+
+std::vector<std::string> GroupByEngine::GroupsOf(const Account &account) const
+{
+    std::vector<std::string> names;
+    for (GroupKey key : keys_)
+    {
+        std::string prefix = std::string(KeyName(key)) + "/";
+        switch (key)
+        {
+        case Group_Type:
+            names.push_back(prefix + account.type_);
+            break;
+        case Group_Bank:
+            names.push_back(prefix + account.bank_);
+            break;
+        case Group_Currency:
+            names.push_back(prefix + account.currency_);
+            break;
+        case Group_Owner:
+            names.push_back(prefix + (account.owner_.empty() ? "Unassigned" : account.owner_));
+            break;
+        case Group_Tag:
+        {
+            // An account counts towards each of its tags
+            std::istringstream tags(account.tags_);
+            std::string tag;
+            while (std::getline(tags, tag, ';'))
+            {
+                if (!tag.empty())
+                    names.push_back(prefix + tag);
+            }
+            break;
+        }
+        case Group_Liquidity:
+            names.push_back(prefix + LiquidityTier(account.type_));
+            break;
+        default:
+            break;
+        }
+    }
+    return names;
+}
+
+void GroupByEngine::Apply(const Account &account, double sign)
+{
+    for (const std::string &name : GroupsOf(account))
+    {
+        if (sign < 0 && groups_.find(name) == groups_.end())
+        {
+            continue;
+        }
+        Group &group = groups_[name];
+        Partial &partial = group.byCurrency_[account.currency_];
+        partial.balance_ += sign * account.balance();
+        partial.weightedInterest_ += sign * account.balance() * account.interest();
+        group.valid_ = false;
+
+        if (sign > 0)
+        {
+            group.accounts_++;
+        }
+        else if (--group.accounts_ == 0)
+        {
+            // Dropping empty groups also discards rounding left over from removals
+            groups_.erase(name);
+        }
+    }
+}
+
+void GroupByEngine::Configure(const std::vector<GroupKey> &keys, const std::vector<Account> &accountList)
+{
+    keys_ = keys;
+    groups_.clear();
+    for (const Account &account : accountList)
+    {
+        Apply(account, 1);
+    }
+}
+
+const std::vector<GroupKey> &GroupByEngine::Keys() const { return keys_; }
+
+void GroupByEngine::Add(const Account &account) { Apply(account, 1); }
+
+void GroupByEngine::Remove(const Account &account) { Apply(account, -1); }
+
+void GroupByEngine::Update(const Account &before, const Account &after)
+{
+    Apply(before, -1);
+    Apply(after, 1);
+}
+
+std::vector<GroupResult> GroupByEngine::Results(const FxRates &rates, const std::string &currency)
+{
+    // Cached results are only good for the currency and day they were converted on
+    int today = Today();
+    if (currency != resultCurrency_ || today != resultDay_)
+    {
+        for (auto &entry : groups_)
+        {
+            entry.second.valid_ = false;
+        }
+        resultCurrency_ = currency;
+        resultDay_ = today;
+    }
+
+    std::vector<GroupResult> results;
+    results.reserve(groups_.size());
+    for (auto &entry : groups_)
+    {
+        Group &group = entry.second;
+        if (!group.valid_)
+        {
+            GroupResult &result = group.result_;
+            result.name_ = entry.first;
+            result.balance_ = 0;
+            double weightedInterest = 0;
+            for (const auto &partial : group.byCurrency_)
+            {
+                double rate = rates.Rate(partial.first, currency, today);
+                result.balance_ += partial.second.balance_ * rate;
+                weightedInterest += partial.second.weightedInterest_ * rate;
+            }
+            result.interest_ = weightedInterest * 0.01;
+            result.interestRate_ = result.balance_ != 0 ? weightedInterest / result.balance_ : 0;
+            result.accounts_ = group.accounts_;
+            group.valid_ = true;
+        }
+        results.push_back(group.result_);
+    }
+
+    std::sort(results.begin(), results.end(), [](const GroupResult &a, const GroupResult &b)
+              { return a.name_ < b.name_; });
+    return results;
+}
+
+std::map<std::string, double> GroupByEngine::Totals(const FxRates &rates, const std::string &currency)
+{
+    std::map<std::string, double> totals;
+    for (const GroupResult &result : Results(rates, currency))
+    {
+        totals[result.name_] = result.balance_;
+    }
+    return totals;
+}
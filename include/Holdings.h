@@ -0,0 +1,172 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <set>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <unordered_map>
+
+// Class representing a quantity of a priced instrument, such as a fund or coin, held in an account
+class Holding
+{
+public:
+    std::string account_;    // Name of the account holding the instrument, which no other account may have
+    std::string instrument_;
+    double quantity_;
+
+    Holding(const std::string &account, const std::string &instrument, double quantity);
+};
+
+// Class valuing accounts as quantity × price over their holdings. Prices are in the currency of
+// the holding account, and holdings are indexed by instrument so a price change only revalues
+// the accounts holding that instrument.
+class HoldingsBook
+{
+private:
+    std::vector<Holding> holdings_;
+    std::unordered_map<std::string, double> prices_;
+    // Positions in holdings_ of each instrument's and each account's holdings
+    std::unordered_map<std::string, std::vector<size_t>> byInstrument_;
+    std::unordered_map<std::string, std::vector<size_t>> byAccount_;
+
+public:
+    /**
+     * Load holdings from the holdings CSV file, replacing any already held.
+     *
+     * Each line is "account,instrument,quantity[,price]", the price being the last known one
+     * so accounts can be valued before the first tick arrives.
+     */
+    void LoadFromCSV(const std::string &path = "holdings.csv");
+
+    void AddHolding(const Holding &holding);
+
+    // True if the account's balance comes from its holdings
+    bool Holds(const std::string &account) const;
+
+    // True if the account has holdings and every one of them has a price
+    bool Priced(const std::string &account) const;
+
+    // Latest price of an instrument, or 0 if it has never been priced
+    double Price(const std::string &instrument) const;
+
+    // Value of an account's holdings at the latest prices
+    double Value(const std::string &account) const;
+
+    /**
+     * Apply new instrument prices.
+     *
+     * @param prices Latest price per instrument.
+     * @param revalued Output set, extended with the accounts whose holdings were repriced.
+     */
+    void ApplyPrices(const std::unordered_map<std::string, double> &prices, std::set<std::string> &revalued);
+};
+
+// Implementation
+
+Holding::Holding(const std::string &account, const std::string &instrument, double quantity)
+    : account_(account), instrument_(instrument), quantity_(quantity)
+{
+}
+
+void HoldingsBook::LoadFromCSV(const std::string &path)
+{
+    holdings_.clear();
+    prices_.clear();
+    byInstrument_.clear();
+    byAccount_.clear();
+
+    std::ifstream file(path);
+    if (!file.is_open())
+    {
+        return;
+    }
+    std::string line;
+
+    while (std::getline(file, line))
+    {
+        std::istringstream ss(line);
+        std::string account, instrument;
+        double quantity, price;
+        if (std::getline(ss, account, ',') &&
+            std::getline(ss, instrument, ',') &&
+            ss >> quantity)
+        {
+            AddHolding(Holding(account, instrument, quantity));
+            if (ss.ignore() && ss >> price)
+            {
+                prices_[instrument] = price;
+            }
+        }
+        else if (!line.empty())
+        {
+            std::cerr << "Invalid holding: " << line << std::endl;
+        }
+    }
+}
+
+void HoldingsBook::AddHolding(const Holding &holding)
+{
+    size_t position = holdings_.size();
+    holdings_.push_back(holding);
+    byInstrument_[holding.instrument_].push_back(position);
+    byAccount_[holding.account_].push_back(position);
+}
+
+bool HoldingsBook::Holds(const std::string &account) const { return byAccount_.count(account) > 0; }
+
+bool HoldingsBook::Priced(const std::string &account) const
+{
+    auto positions = byAccount_.find(account);
+    if (positions == byAccount_.end())
+    {
+        return false;
+    }
+    for (size_t position : positions->second)
+    {
+        if (!prices_.count(holdings_[position].instrument_))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+double HoldingsBook::Price(const std::string &instrument) const
+{
+    auto price = prices_.find(instrument);
+    return price != prices_.end() ? price->second : 0;
+}
+
+double HoldingsBook::Value(const std::string &account) const
+{
+    double value = 0;
+    auto positions = byAccount_.find(account);
+    if (positions != byAccount_.end())
+    {
+        for (size_t position : positions->second)
+        {
+            value += holdings_[position].quantity_ * Price(holdings_[position].instrument_);
+        }
+    }
+    return value;
+}
+
+void HoldingsBook::ApplyPrices(const std::unordered_map<std::string, double> &prices, std::set<std::string> &revalued)
+{
+    for (const auto &price : prices)
+    {
+        auto positions = byInstrument_.find(price.first);
+        if (positions == byInstrument_.end())
+        {
+            // Ticks for instruments nobody holds are ignored
+            continue;
+        }
+        prices_[price.first] = price.second;
+        for (size_t position : positions->second)
+        {
+            revalued.insert(holdings_[position].account_);
+        }
+    }
+}
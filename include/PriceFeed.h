@@ -0,0 +1,150 @@
+#pragma once
+
+#include <string>
+#include <iostream>
+#include <charconv>
+#include <algorithm>
+#include <unordered_map>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+// Class reading "instrument,price" ticks, one per line, from a file being appended to or a
+// FIFO. Poll never blocks, and only the latest price of each instrument is kept until drained,
+// so however fast ticks arrive the reader applies at most one price per instrument per drain.
+class PriceFeed
+{
+private:
+    std::string path_;
+    int fd_;
+    // Bytes of a line not yet terminated by a newline
+    std::string partial_;
+    std::unordered_map<std::string, double> latest_;
+    std::string instrument_;
+
+    void Open();
+    void ParseLine(const char *begin, const char *end);
+
+public:
+    // Bytes read per Poll at most, so a large backlog is worked through over several frames
+    static const size_t maxPollBytes_ = 1 << 20;
+
+    // Constructor to follow the given file or FIFO, which need not exist yet
+    PriceFeed(const std::string &path = "prices.feed");
+    ~PriceFeed();
+
+    PriceFeed(const PriceFeed &) = delete;
+    PriceFeed &operator=(const PriceFeed &) = delete;
+
+    /**
+     * Read ticks that have arrived since the last poll, without blocking.
+     *
+     * @return Number of ticks read.
+     */
+    size_t Poll();
+
+    // Remove and return the latest price of each instrument ticked since the last drain
+    std::unordered_map<std::string, double> Drain();
+};
+
+// Implementation
+
+PriceFeed::PriceFeed(const std::string &path)
+    : path_(path), fd_(-1)
+{
+    Open();
+}
+
+PriceFeed::~PriceFeed()
+{
+    if (fd_ >= 0)
+    {
+        close(fd_);
+    }
+}
+
+void PriceFeed::Open()
+{
+    // Non-blocking, so opening a FIFO does not wait for a writer
+    fd_ = open(path_.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+}
+
+size_t PriceFeed::Poll()
+{
+    if (fd_ < 0)
+    {
+        Open();
+        if (fd_ < 0)
+        {
+            return 0;
+        }
+    }
+
+    // Start again from the top of a regular file that was truncated
+    struct stat info;
+    if (fstat(fd_, &info) == 0 && S_ISREG(info.st_mode) && info.st_size < lseek(fd_, 0, SEEK_CUR))
+    {
+        lseek(fd_, 0, SEEK_SET);
+        partial_.clear();
+    }
+
+    size_t ticks = 0;
+    size_t total = 0;
+    char buffer[64 * 1024];
+    ssize_t length;
+    while (total < maxPollBytes_ && (length = read(fd_, buffer, sizeof(buffer))) > 0)
+    {
+        total += static_cast<size_t>(length);
+        const char *begin = buffer;
+        const char *end = buffer + length;
+
+        // Complete a line split across reads
+        if (!partial_.empty())
+        {
+            const char *newline = std::find(begin, end, '\n');
+            partial_.append(begin, newline);
+            if (newline == end)
+            {
+                continue;
+            }
+            ParseLine(partial_.data(), partial_.data() + partial_.size());
+            partial_.clear();
+            ++ticks;
+            begin = newline + 1;
+        }
+
+        for (const char *newline; (newline = std::find(begin, end, '\n')) != end; begin = newline + 1)
+        {
+            ParseLine(begin, newline);
+            ++ticks;
+        }
+        partial_.assign(begin, end);
+    }
+    return ticks;
+}
+
+void PriceFeed::ParseLine(const char *begin, const char *end)
+{
+    const char *comma = std::find(begin, end, ',');
+    if (comma == end)
+    {
+        return;
+    }
+    double price;
+    std::from_chars_result result = std::from_chars(comma + 1, end, price);
+    if (result.ec != std::errc())
+    {
+        return;
+    }
+
+    // Reuse one key buffer, so a tick for a known instrument does not allocate
+    instrument_.assign(begin, comma);
+    latest_[instrument_] = price;
+}
+
+std::unordered_map<std::string, double> PriceFeed::Drain()
+{
+    std::unordered_map<std::string, double> latest;
+    latest.swap(latest_);
+    return latest;
+}
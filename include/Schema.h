@@ -0,0 +1,271 @@
+#pragma once
+
+#include <string>
+#include <tuple>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <charconv>
+#include <cmath>
+#include <algorithm>
+#include <type_traits>
+#include <utility>
+
+// Significant digits written for amounts in CSV files, enough to keep pennies on large balances
+const int CSV_PRECISION = 15;
+
+// A field of record type T, holding a member of type M
+template <typename T, typename M>
+struct Field
+{
+    typedef M Type;
+
+    const char *name_;         // Short name, e.g. the plot series name
+    M T::*member_;
+    const char *label_;        // Longer display name, or null to use the name
+    const char *accountType_;  // For summary balances, the account type summed into the field, or null
+
+    constexpr const char *Label() const { return label_ ? label_ : name_; }
+};
+
+template <typename T, typename M>
+constexpr Field<T, M> MakeField(const char *name, M T::*member, const char *label = nullptr, const char *accountType = nullptr)
+{
+    return Field<T, M>{name, member, label, accountType};
+}
+
+/**
+ * Field list of a record type, specialised next to the record as
+ *
+ *     static constexpr auto fields_ = std::make_tuple(MakeField("Name", &T::name_), ...);
+ *     static constexpr size_t required_ = n; // Leading fields every CSV row must have
+ *
+ * Fields are in file order. Everything below is expanded per field at compile time, so adding
+ * a field to the tuple is enough for it to be read, written, compared and plotted.
+ */
+template <typename T>
+struct Schema;
+
+// Call f with each field of T in order
+template <typename T, typename F>
+void ForEachField(F &&f)
+{
+    std::apply([&f](const auto &...fields)
+               { (f(fields), ...); },
+               Schema<T>::fields_);
+}
+
+// Call f with each field of T in order until it returns false, returning false if it did
+template <typename T, typename F>
+bool AllFields(F &&f)
+{
+    return std::apply([&f](const auto &...fields)
+                      { return (f(fields) && ...); },
+                      Schema<T>::fields_);
+}
+
+// Number of fields of T
+template <typename T>
+constexpr size_t FieldCount = std::tuple_size<typename std::decay<decltype(Schema<T>::fields_)>::type>::value;
+
+template <typename T, typename F, size_t... I>
+void ForEachFieldIndexed(F &f, std::index_sequence<I...>)
+{
+    (f(std::get<I>(Schema<T>::fields_), std::integral_constant<size_t, I>()), ...);
+}
+
+// Call f with each field of T and its position as a std::integral_constant, for use as a tuple index
+template <typename T, typename F>
+void ForEachFieldIndexed(F &&f)
+{
+    ForEachFieldIndexed<T>(f, std::make_index_sequence<FieldCount<T>>());
+}
+
+constexpr bool SameName(const char *a, const char *b)
+{
+    while (*a && *a == *b)
+    {
+        ++a;
+        ++b;
+    }
+    return *a == *b;
+}
+
+// Position of the field of T with the given name, or -1; usable at compile time
+template <typename T>
+constexpr int FieldIndex(const char *name)
+{
+    return std::apply([name](const auto &...fields)
+                      {
+                          int index = 0;
+                          int found = -1;
+                          ((found = (found < 0 && SameName(fields.name_, name)) ? index : found, ++index), ...);
+                          return found; },
+                      Schema<T>::fields_);
+}
+
+template <typename FieldType>
+constexpr bool IsNumericField = std::is_same<typename std::decay<FieldType>::type::Type, double>::value;
+
+// Call f with each double field of T in order, e.g. the balances of a summary
+template <typename T, typename F>
+void ForEachNumericField(F &&f)
+{
+    ForEachField<T>([&f](const auto &field)
+                    {
+                        if constexpr (IsNumericField<decltype(field)>)
+                            f(field); });
+}
+
+// Number of double fields of T
+template <typename T>
+constexpr size_t NumericFieldCount = std::apply([](const auto &...fields)
+                                                { return (size_t(0) + ... + (IsNumericField<decltype(fields)> ? 1 : 0)); },
+                                                Schema<T>::fields_);
+
+// Values of the double fields of a record, in schema order
+template <typename T>
+std::array<double, NumericFieldCount<T>> NumericValues(const T &record)
+{
+    std::array<double, NumericFieldCount<T>> values{};
+    size_t i = 0;
+    ForEachNumericField<T>([&](const auto &field)
+                           { values[i++] = record.*field.member_; });
+    return values;
+}
+
+// CSV and binary encoding of a single value
+
+inline void EncodeCSVValue(std::string &out, const std::string &value) { out += value; }
+
+inline void EncodeCSVValue(std::string &out, double value)
+{
+    // Same text as a stream with precision CSV_PRECISION, without the stream
+    char buffer[32];
+    std::to_chars_result result = std::to_chars(buffer, buffer + sizeof(buffer), value, std::chars_format::general, CSV_PRECISION);
+    out.append(buffer, result.ptr);
+}
+
+inline bool DecodeCSVValue(const char *begin, const char *end, std::string &value)
+{
+    value.assign(begin, end);
+    return true;
+}
+
+inline bool DecodeCSVValue(const char *begin, const char *end, double &value)
+{
+    // Allow the spaces and '+' that hand-edited files may have, as stream extraction did
+    while (begin != end && *begin == ' ')
+        ++begin;
+    if (begin != end && *begin == '+')
+        ++begin;
+    // from_chars also reads nan and inf, which are never a valid amount
+    return begin != end && std::from_chars(begin, end, value).ec == std::errc() && std::isfinite(value);
+}
+
+inline void EncodeBinaryValue(std::string &out, double value)
+{
+    char bytes[sizeof(double)];
+    std::memcpy(bytes, &value, sizeof(double));
+    out.append(bytes, sizeof(double));
+}
+
+inline void EncodeBinaryValue(std::string &out, const std::string &value)
+{
+    uint32_t length = static_cast<uint32_t>(value.size());
+    char bytes[sizeof(length)];
+    std::memcpy(bytes, &length, sizeof(length));
+    out.append(bytes, sizeof(length));
+    out += value;
+}
+
+inline bool DecodeBinaryValue(const char *&pos, const char *end, double &value)
+{
+    if (end - pos < static_cast<std::ptrdiff_t>(sizeof(double)))
+        return false;
+    std::memcpy(&value, pos, sizeof(double));
+    pos += sizeof(double);
+    return true;
+}
+
+inline bool DecodeBinaryValue(const char *&pos, const char *end, std::string &value)
+{
+    uint32_t length;
+    if (end - pos < static_cast<std::ptrdiff_t>(sizeof(length)))
+        return false;
+    std::memcpy(&length, pos, sizeof(length));
+    pos += sizeof(length);
+    if (static_cast<size_t>(end - pos) < length)
+        return false;
+    value.assign(pos, length);
+    pos += length;
+    return true;
+}
+
+// Record codecs
+
+// Append the schema fields of a record to out as comma-separated values, without a newline
+template <typename T>
+void EncodeCSV(const T &record, std::string &out)
+{
+    bool first = true;
+    ForEachField<T>([&](const auto &field)
+                    {
+                        if (!first)
+                            out += ',';
+                        first = false;
+                        EncodeCSVValue(out, record.*field.member_); });
+}
+
+/**
+ * Parse the schema fields of a CSV row into a record.
+ *
+ * Fields missing from the end of the row are left as they were, so rows written before a field
+ * was added keep its default.
+ *
+ * @param pos Start of the row, moved past the fields read and the separator after them.
+ * @param end End of the row, excluding the newline.
+ * @param record Record to fill.
+ * @return True if at least the required fields were read and every field read was valid.
+ */
+template <typename T>
+bool DecodeCSV(const char *&pos, const char *end, T &record)
+{
+    size_t count = 0;
+    bool atEnd = pos == end;
+    bool valid = AllFields<T>([&](const auto &field)
+                              {
+                                  if (atEnd)
+                                      return true;
+                                  const char *comma = std::find(pos, end, ',');
+                                  if (!DecodeCSVValue(pos, comma, record.*field.member_))
+                                      return false;
+                                  ++count;
+                                  atEnd = comma == end;
+                                  pos = atEnd ? end : comma + 1;
+                                  return true; });
+    return valid && count >= Schema<T>::required_;
+}
+
+// Append the schema fields of a record to out in binary, strings prefixed by their length
+template <typename T>
+void EncodeBinary(const T &record, std::string &out)
+{
+    ForEachField<T>([&](const auto &field)
+                    { EncodeBinaryValue(out, record.*field.member_); });
+}
+
+/**
+ * Read a record written by EncodeBinary.
+ *
+ * @param pos Start of the record, moved past it.
+ * @param end End of the available bytes.
+ * @param record Record to fill.
+ * @return True if every field was complete.
+ */
+template <typename T>
+bool DecodeBinary(const char *&pos, const char *end, T &record)
+{
+    return AllFields<T>([&](const auto &field)
+                        { return DecodeBinaryValue(pos, end, record.*field.member_); });
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "Account.h"
+#include <chrono>
+
+// Class queueing finance summary snapshots so they can be appended to history CSV file in batches
+class SnapshotScheduler
+{
+private:
+    std::vector<FinanceSummary> pending_;
+    std::unique_ptr<FinanceSummary> lastStored_;
+    size_t batchSize_;
+    std::chrono::steady_clock::duration maxAge_;
+    // When the oldest queued snapshot was captured
+    std::chrono::steady_clock::time_point oldestQueuedAt_;
+
+public:
+    // Balance differences below half a penny, which round away at two decimals, are not treated as a change
+    static constexpr double epsilon_ = 0.005;
+
+    /**
+     * Constructor to create an empty scheduler.
+     *
+     * @param batchSize Number of queued snapshots that triggers a write.
+     * @param maxAge Longest a snapshot may wait in the queue before triggering a write.
+     */
+    SnapshotScheduler(size_t batchSize = 8, std::chrono::steady_clock::duration maxAge = std::chrono::minutes(15));
+
+    // Change how long a snapshot may wait in the queue, e.g. to follow the snapshot interval
+    void SetMaxAge(std::chrono::steady_clock::duration maxAge);
+
+    /**
+     * Set the summary new snapshots are compared against, e.g. the last row loaded from history.
+     */
+    void SetLastStored(const FinanceSummary &summary);
+
+    /**
+     * Queue a snapshot unless it matches the last stored or queued one.
+     *
+     * @param summary Summary to snapshot.
+     * @return True if the snapshot was queued.
+     */
+    bool Capture(const FinanceSummary &summary);
+
+    // True once enough snapshots are queued to be worth a write, or the oldest has waited too long
+    bool ShouldFlush() const;
+
+    // Remove and return all queued snapshots, oldest first
+    std::vector<FinanceSummary> TakePending();
+};
+
+// Implementation
+
+SnapshotScheduler::SnapshotScheduler(size_t batchSize, std::chrono::steady_clock::duration maxAge)
+    : batchSize_(batchSize > 0 ? batchSize : 1), maxAge_(maxAge)
+{
+}
+
+void SnapshotScheduler::SetMaxAge(std::chrono::steady_clock::duration maxAge)
+{
+    maxAge_ = maxAge;
+}
+
+void SnapshotScheduler::SetLastStored(const FinanceSummary &summary)
+{
+    lastStored_.reset(new FinanceSummary(summary));
+}
+
+bool SnapshotScheduler::Capture(const FinanceSummary &summary)
+{
+    if (lastStored_ && summary.SameBalancesAs(*lastStored_, epsilon_))
+    {
+        return false;
+    }
+    if (pending_.empty())
+    {
+        oldestQueuedAt_ = std::chrono::steady_clock::now();
+    }
+    pending_.push_back(summary);
+    SetLastStored(summary);
+    return true;
+}
+
+bool SnapshotScheduler::ShouldFlush() const
+{
+    return pending_.size() >= batchSize_ ||
+           (!pending_.empty() && std::chrono::steady_clock::now() - oldestQueuedAt_ >= maxAge_);
+}
+
+std::vector<FinanceSummary> SnapshotScheduler::TakePending()
+{
+    std::vector<FinanceSummary> pending;
+    pending.swap(pending_);
+    return pending;
+}
+
@@ -1,9 +1,19 @@
 #include "../include/Account.h"
+#include "../include/SnapshotScheduler.h"
+#include "../include/AccountIndex.h"
+#include "../include/FileWatcher.h"
+#include "../include/GroupBy.h"
+#include "../include/Forecast.h"
+#include "../include/Holdings.h"
+#include "../include/PriceFeed.h"
+#include "../include/Analytics.h"
 #include "wx/wx.h"
 #include <wx/spinctrl.h>
+#include <wx/numdlg.h>
 #include "wx/grid.h"
 #include "wx/mathplot.h"
 #include <locale.h>
+#include <functional>
 
 // Application class
 class MyApp : public wxApp
@@ -12,11 +22,64 @@ public:
     virtual bool OnInit() wxOVERRIDE;
 };
 
+// Symbol shown in front of amounts in a currency, falling back to the currency code
+wxString CurrencySymbol(const std::string &currency)
+{
+    if (currency == "GBP")
+        return wxT("£");
+    if (currency == "USD")
+        return wxT("$");
+    if (currency == "EUR")
+        return wxT("€");
+    return wxString(currency) + " ";
+}
+
+// HOME: Grid table presenting accounts through the account indexes, so only visible rows are read
+class AccountGridTable : public wxGridTableBase
+{
+public:
+    AccountGridTable(SavedData &data, AccountIndex &index, std::function<void(size_t, const Account &)> applyEdit);
+
+    // wxGridTableBase interface
+    int GetNumberRows() wxOVERRIDE;
+    int GetNumberCols() wxOVERRIDE;
+    bool IsEmptyCell(int row, int col) wxOVERRIDE;
+    wxString GetValue(int row, int col) wxOVERRIDE;
+    void SetValue(int row, int col, const wxString &value) wxOVERRIDE;
+    wxString GetColLabelValue(int col) wxOVERRIDE;
+
+    // Sort by a column, toggling direction if it is already the sort column
+    void SortByColumn(int col);
+    int SortColumn() const;
+    bool SortAscending() const;
+
+    // Only show accounts whose bank, name or type contain the filter text
+    void SetFilter(const wxString &text);
+
+    // Recompute visible rows from the indexes and tell the grid about row count changes
+    void RebuildView();
+
+    // True if a rebuild was held back while a cell was being edited
+    bool ViewStale() const;
+
+private:
+    SavedData &data;
+    AccountIndex &index;
+    // Stores an edited account and keeps everything derived from it in step
+    std::function<void(size_t, const Account &)> applyEdit;
+    std::vector<size_t> rows;
+    int sortColumn;
+    bool sortAscending;
+    std::string filter;
+    bool viewStale;
+};
+
 // HOME: Frame class
 class HomeFrame : public wxFrame
 {
 public:
     HomeFrame(const wxString &title);
+    ~HomeFrame();
 
     // Event handlers
     void OnQuit(wxCommandEvent &event);
@@ -24,15 +87,58 @@ public:
     void OnAddAccount(wxCommandEvent &event);
     void OnVisualise(wxCommandEvent &event);
     void OnSaveSummary(wxCommandEvent &event);
+    void OnAutoSnapshot(wxCommandEvent &event);
+    void OnBaseCurrency(wxCommandEvent &event);
+    void OnGroupBy(wxCommandEvent &event);
+    void OnForecast(wxCommandEvent &event);
+    void OnSnapshotTimer(wxTimerEvent &event);
+    void OnWatchTimer(wxTimerEvent &event);
+    void OnPriceTimer(wxTimerEvent &event);
     void OnGridCellChange(wxGridEvent &event);
+    void OnGridEditorHidden(wxGridEvent &event);
+    void OnGridLabelClick(wxGridEvent &event);
+    void OnFilter(wxCommandEvent &event);
+    void OnClose(wxCloseEvent &event);
 
     // Public methods to update frame contents
     void LoadData();
 
-    
+    // Show the current summary and group totals
+    void ShowSummary();
+
+    // Write queued snapshots to history
+    void FlushSnapshots();
+
+    // Queue a snapshot of the summary unless it would leave out accounts, returning true if queued
+    bool CaptureSnapshot();
+
+    // Summarise the accounts, including the configured group totals
+    FinanceSummary Summarise();
+
+    // Change accounts, keeping the indexes and group totals in step
+    void AddAccount(const Account &account);
+    void UpdateAccount(size_t id, const Account &edited);
+    void RemoveLastAccount();
+
+    /**
+     * Set new balances for many accounts as one change, e.g. valuations from the price feed.
+     *
+     * The summary is adjusted by each account's change rather than recomputed, and rows are only
+     * re-sorted when sorted by balance. The accounts file is left to the next deferred write.
+     *
+     * @param balances Account positions and their new balances.
+     */
+    void RevalueAccounts(const std::vector<std::pair<size_t, double>> &balances);
 
     // Store program data
     SavedData savedData;
+    AccountIndex accountIndex;
+    GroupByEngine groupBy;
+    HoldingsBook holdings;
+
+    // Recurring transactions and the balances last forecast from them
+    ForecastEngine forecastEngine;
+    Forecast forecast;
 
 private:
     // Helper functions to set up frame contents
@@ -42,11 +148,48 @@ private:
     void InitializeGrid();
     // void SetSizerAndFit();
 
+    // Apply changes other writers made to the data files
+    void ReloadAccounts();
+    void ReloadHistory();
+    void ResetSnapshotBaseline();
+
+    // Write accounts file and clear any deferred write
+    void PersistAccounts();
+
+    // Tell the user, once per account name, that holdings were not valued because the name is shared
+    void ReportSharedHolding(const std::string &name, size_t accounts);
+
     // wx Components for the frame
     wxGrid *grid;
-    wxStaticText *summaryBoxes[8];
+    AccountGridTable *gridTable;
+    wxTextCtrl *filterCtrl;
+    wxStaticText *summaryBoxes[NumericFieldCount<FinanceSummary>];
+    wxBoxSizer *groupSizer;
     wxButton *saveSummaryButton;
 
+    // Periodic snapshots of the summary to history
+    SnapshotScheduler snapshotScheduler;
+    wxTimer snapshotTimer;
+    int snapshotIntervalMinutes;
+
+    // Watch data files for changes made by other writers
+    FileWatcher fileWatcher;
+    wxTimer watchTimer;
+
+    int forecastYears;
+
+    // Drain price ticks once per UI frame; revaluations are written at most once a second
+    PriceFeed priceFeed;
+    wxTimer priceTimer;
+    bool accountsDirty;
+    wxLongLong accountsWrittenAt;
+
+    // Account currencies without exchange rates to the base currency, left out of totals
+    std::set<std::string> missingCurrencies;
+
+    // Account names holdings were not valued for because several accounts share them
+    std::set<std::string> sharedHoldings;
+
     wxDECLARE_EVENT_TABLE();
 };
 
@@ -59,23 +202,85 @@ public:
 private:
     // Event handlers and variables to store input values
     void OnSubmit(wxCommandEvent &event);
-    wxTextCtrl *nameCtrl;
-    wxTextCtrl *bankCtrl;
-    wxSpinCtrlDouble *balanceCtrl;
-    wxSpinCtrlDouble *interestCtrl;
-    wxTextCtrl *typeCtrl;
+    // One control per field of Schema<Account>, a spin control for amounts and a text box otherwise
+    wxWindow *fieldCtrls[FieldCount<Account>];
 
     wxDECLARE_EVENT_TABLE();
 };
 
-// VISUALISE Frame class
-class VisualiseFrame : public wxFrame
+// VISUALISE: Line layer plotting one finance summary series. Points are appended in O(1)
+// and the bounding box is kept as running min/max, so a growing plot never rescans its data.
+class LineLayer : public mpFXY
+{
+public:
+    LineLayer(const wxString &name, const wxColour &colour = *wxBLUE);
+
+    // mpFXY interface
+    void Rewind() wxOVERRIDE;
+    bool GetNextXY(double &x, double &y) wxOVERRIDE;
+    double GetMinX() wxOVERRIDE;
+    double GetMaxX() wxOVERRIDE;
+    double GetMinY() wxOVERRIDE;
+    double GetMaxY() wxOVERRIDE;
+
+    void Append(double x, double y);
+    void Clear();
+
+private:
+    std::vector<double> xs;
+    std::vector<double> ys;
+    size_t position;
+    double minX, maxX, minY, maxY;
+};
+
+// VISUALISE Frame class, a live view over the saved history
+class VisualiseFrame : public wxFrame, public HistoryObserver
 {
 public:
     VisualiseFrame(wxWindow *parent);
+    ~VisualiseFrame();
+
+    // HistoryObserver interface
+    void OnSummariesAdded(const std::vector<FinanceSummary> &added) wxOVERRIDE;
+    void OnHistoryReset() wxOVERRIDE;
+
+    // Plot forecast balances after the history, replacing any earlier forecast
+    void SetForecast(const Forecast &forecast);
+
+    // Relabel and replot everything in the new base currency, with the forecast rerun in it
+    void OnBaseCurrencyChanged(const Forecast &forecast);
 
 private:
     void CreatePlot();
+    void CreateAnalyticsPlot();
+    void AppendPoint(const FinanceSummary &summary);
+    void IncludeInBounds(double x, double y);
+    void FitPlot();
+
+    // Recompute analytics over a new number of snapshots
+    void OnWindowChange(wxSpinEvent &event);
+
+    SavedData &savedData;
+
+    // Plot window, one layer per series, and running bounds over all layers
+    mpWindow *plotWindow;
+    mpScaleY *yAxis;
+    std::vector<LineLayer *> lineLayers;
+    // Layers for account groups, added as groups first appear in the history
+    std::map<std::string, LineLayer *> groupLayers;
+    // Dashed layers continuing the total and per-type series into the future
+    std::vector<LineLayer *> forecastLayers;
+    // X is days from today; lastX places snapshots without a readable date after the previous one
+    double lastX;
+    double minX, maxX;
+    double minY, maxY;
+
+    // Rolling analytics of the same snapshots, on their own plot as they are in percent
+    AnalyticsEngine analytics;
+    mpWindow *analyticsWindow;
+    std::vector<LineLayer *> analyticsLayers;
+    wxSpinCtrl *windowCtrl;
+    double analyticsMinY, analyticsMaxY;
 
     wxDECLARE_EVENT_TABLE();
 };
@@ -88,7 +293,15 @@ enum
     Add_Account = 1,
     Submit_Account = 2,
     Save_Summary = 3,
-    Visualise = 4
+    Visualise = 4,
+    Auto_Snapshot = 5,
+    Snapshot_Timer = 6,
+    Filter_Accounts = 7,
+    Base_Currency = 8,
+    Watch_Timer = 9,
+    Group_By = 10,
+    Forecast_Balances = 11,
+    Price_Timer = 12
 };
 
 wxBEGIN_EVENT_TABLE(HomeFrame, wxFrame)
@@ -97,6 +310,15 @@ wxBEGIN_EVENT_TABLE(HomeFrame, wxFrame)
             EVT_MENU(Add_Account, HomeFrame::OnAddAccount)
                 EVT_MENU(Visualise, HomeFrame::OnVisualise)
                     EVT_BUTTON(Save_Summary, HomeFrame::OnSaveSummary)
+                        EVT_MENU(Auto_Snapshot, HomeFrame::OnAutoSnapshot)
+                            EVT_TIMER(Snapshot_Timer, HomeFrame::OnSnapshotTimer)
+                                EVT_CLOSE(HomeFrame::OnClose)
+                                    EVT_TEXT(Filter_Accounts, HomeFrame::OnFilter)
+                                        EVT_MENU(Base_Currency, HomeFrame::OnBaseCurrency)
+                                            EVT_TIMER(Watch_Timer, HomeFrame::OnWatchTimer)
+                                                EVT_MENU(Group_By, HomeFrame::OnGroupBy)
+                                                    EVT_MENU(Forecast_Balances, HomeFrame::OnForecast)
+                                                        EVT_TIMER(Price_Timer, HomeFrame::OnPriceTimer)
                         wxEND_EVENT_TABLE()
 
                             wxBEGIN_EVENT_TABLE(AccountAddFrame, wxFrame)
@@ -123,19 +345,47 @@ bool MyApp::OnInit()
 
 // HOME: Frame constructor
 HomeFrame::HomeFrame(const wxString &title)
-    : wxFrame(NULL, wxID_ANY, title, wxDefaultPosition, wxSize(800, 600)) // Set the size here
+    : wxFrame(NULL, wxID_ANY, title, wxDefaultPosition, wxSize(800, 600)), // Set the size here
+      snapshotTimer(this, Snapshot_Timer),
+      snapshotIntervalMinutes(15),
+      fileWatcher({"accounts.csv", "history.csv"}),
+      watchTimer(this, Watch_Timer),
+      forecastYears(10),
+      priceTimer(this, Price_Timer),
+      accountsDirty(false),
+      accountsWrittenAt(0)
 {
+    // Load initial data
+    savedData = SavedData();
+    holdings.LoadFromCSV();
+    accountIndex.Build(savedData.accountList_);
+    // Groupings carry over between sessions, so snapshots keep the same group totals
+    groupBy.Configure(GroupByEngine::LoadKeys(), savedData.accountList_);
+
     // Create frame elements
     CreateMenu();
     grid = CreateGrid();
     CreateSummaryBoxes();
-
-    // Load initial data
-    savedData = SavedData();
     LoadData();
 
-    // Bind event handler for cell value changes
+    // Only snapshot once balances move away from the last saved history row
+    if (!savedData.savedSummaryList_.empty())
+        snapshotScheduler.SetLastStored(savedData.savedSummaryList_.back());
+    snapshotScheduler.SetMaxAge(std::chrono::minutes(snapshotIntervalMinutes));
+    snapshotTimer.Start(snapshotIntervalMinutes * 60 * 1000);
+    watchTimer.Start(500);
+    priceTimer.Start(33);
+
+    // Bind event handler for cell value changes and header clicks
     grid->Bind(wxEVT_GRID_CELL_CHANGED, &HomeFrame::OnGridCellChange, this);
+    grid->Bind(wxEVT_GRID_EDITOR_HIDDEN, &HomeFrame::OnGridEditorHidden, this);
+    grid->Bind(wxEVT_GRID_LABEL_LEFT_CLICK, &HomeFrame::OnGridLabelClick, this);
+}
+
+HomeFrame::~HomeFrame()
+{
+    // Child frames observe savedData, so they must go before it does
+    DestroyChildren();
 }
 
 // HOME: Create UI elements
@@ -148,6 +398,10 @@ void HomeFrame::CreateMenu()
 
     fileMenu->Append(Add_Account, "Add Account", "Add a financial account");
     fileMenu->Append(Visualise, "Visualise", "Visualise financial history");
+    fileMenu->Append(Auto_Snapshot, "Auto Snapshot...", "Set how often the summary is saved automatically");
+    fileMenu->Append(Base_Currency, "Base Currency...", "Set the currency totals and history are shown in");
+    fileMenu->Append(Group_By, "Group By...", "Choose how account totals are grouped");
+    fileMenu->Append(Forecast_Balances, "Forecast...", "Forecast balances from recurring transactions");
     fileMenu->Append(Minimal_Quit, "E&xit\tAlt-X", "Quit this program");
 
     wxMenuBar *menuBar = new wxMenuBar();
@@ -171,26 +425,30 @@ void HomeFrame::CreateMenu()
 
 void HomeFrame::CreateSummaryBoxes()
 {
-    // Create a box sizer for the left side with 8 boxes
+    // Create a box sizer for the left side with a box per summary balance
     wxBoxSizer *leftSizer = new wxBoxSizer(wxVERTICAL);
 
-    summaryBoxes[0] = new wxStaticText(this, wxID_ANY, "Total Balance: ");
-    summaryBoxes[1] = new wxStaticText(this, wxID_ANY, "Current Balance: ");
-    summaryBoxes[2] = new wxStaticText(this, wxID_ANY, "Savings Balance: ");
-    summaryBoxes[3] = new wxStaticText(this, wxID_ANY, "Credit Balance: ");
-    summaryBoxes[4] = new wxStaticText(this, wxID_ANY, "ISA Balance: ");
-    summaryBoxes[5] = new wxStaticText(this, wxID_ANY, "GIA Balance: ");
-    summaryBoxes[6] = new wxStaticText(this, wxID_ANY, "Crypto Balance: ");
-    summaryBoxes[7] = new wxStaticText(this, wxID_ANY, "Total Interest: ");
-    for (int i = 0; i < 8; ++i)
-    {
-        leftSizer->Add(summaryBoxes[i], 0, wxEXPAND | wxALL, 5);
-    }
+    size_t i = 0;
+    ForEachNumericField<FinanceSummary>([&](const auto &field)
+                                        {
+                                            summaryBoxes[i] = new wxStaticText(this, wxID_ANY, wxString(field.Label()) + ": ");
+                                            leftSizer->Add(summaryBoxes[i++], 0, wxEXPAND | wxALL, 5); });
+
+    // Group totals are listed below, one box per group
+    groupSizer = new wxBoxSizer(wxVERTICAL);
+    leftSizer->Add(groupSizer, 0, wxEXPAND);
+
+    // Stack the filter box above the grid
+    wxBoxSizer *gridSizer = new wxBoxSizer(wxVERTICAL);
+    filterCtrl = new wxTextCtrl(this, Filter_Accounts, "");
+    filterCtrl->SetHint("Filter by bank, name or type");
+    gridSizer->Add(filterCtrl, 0, wxEXPAND | wxBOTTOM, 5);
+    gridSizer->Add(grid, 1, wxEXPAND);
 
     // Create a horizontal sizer to hold the left boxes and the grid
     wxBoxSizer *mainSizer = new wxBoxSizer(wxHORIZONTAL);
     mainSizer->Add(leftSizer, 0, wxEXPAND | wxALL, 5);
-    mainSizer->Add(grid, 1, wxEXPAND | wxALL, 5);
+    mainSizer->Add(gridSizer, 1, wxEXPAND | wxALL, 5);
 
     // Create the action button and add it below the grid
     wxBoxSizer *bottomSizer = new wxBoxSizer(wxHORIZONTAL);
@@ -209,48 +467,116 @@ void HomeFrame::CreateSummaryBoxes()
 wxGrid *HomeFrame::CreateGrid()
 {
     grid = new wxGrid(this, wxID_ANY);
-    grid->CreateGrid(0, 5); // Initially 0 rows, 5 columns
-    grid->SetColLabelValue(0, "Bank");
-    grid->SetColLabelValue(1, "Name");
-    grid->SetColLabelValue(2, "Balance");
-    grid->SetColLabelValue(3, "Interest");
-    grid->SetColLabelValue(4, "Type");
-    grid->AutoSizeColumns(); // Automatically size columns to fit content
-    grid->HideRowLabels();   // Hide row numbers
+    gridTable = new AccountGridTable(savedData, accountIndex, [this](size_t id, const Account &edited)
+                                     { UpdateAccount(id, edited); });
+    grid->SetTable(gridTable, true); // Grid takes ownership of the table
+    grid->SetDefaultColSize(110);    // Fixed widths, auto-sizing would read every row
+    grid->HideRowLabels();           // Hide row numbers
     return grid;
 }
 
 // HOME: Update data in UI
 void HomeFrame::LoadData()
 {
-    savedData.currentSummary_ = FinanceSummary(savedData.accountList_);
-    FinanceSummary summary = savedData.currentSummary_;
+    savedData.currentSummary_ = Summarise();
+
+    // Update grid rows from the account indexes
+    gridTable->RebuildView();
+    ShowSummary();
+
+    // Currencies only change with a full reload, so they are checked here rather than per price tick
+    missingCurrencies = savedData.UnconvertibleCurrencies();
+    if (!missingCurrencies.empty())
+    {
+        wxString currencies;
+        for (const std::string &currency : missingCurrencies)
+            currencies += (currencies.IsEmpty() ? "" : ", ") + wxString(currency);
+        SetStatusText(wxString::Format("No exchange rate to %s for %s: those accounts are left out of totals and snapshots are paused",
+                                       savedData.baseCurrency_, currencies));
+    }
+}
+
+void HomeFrame::ShowSummary()
+{
+    const FinanceSummary &summary = savedData.currentSummary_;
 
-    // Update grid with account data
-    if (grid->GetNumberRows() > 0)
-        grid->DeleteRows(0, grid->GetNumberRows());
-    for (const Account &account : savedData.accountList_)
+    // Update summary boxes, in the base currency
+    wxString symbol = CurrencySymbol(summary.currency_);
+    size_t box = 0;
+    ForEachNumericField<FinanceSummary>([&](const auto &field)
+                                        { summaryBoxes[box++]->SetLabel(wxString(field.Label()) + ": " + symbol + wxString::Format("%#'.2f", summary.*field.member_)); });
+
+    // There are as many group boxes as configured groups, only recreated when that number changes
+    std::vector<GroupResult> groups = groupBy.Results(savedData.fxRates_, savedData.baseCurrency_);
+    if (groupSizer->GetItemCount() != groups.size())
+    {
+        groupSizer->Clear(true);
+        for (size_t i = 0; i < groups.size(); ++i)
+        {
+            groupSizer->Add(new wxStaticText(this, wxID_ANY, wxEmptyString), 0, wxEXPAND | wxALL, 5);
+        }
+    }
+    for (size_t i = 0; i < groups.size(); ++i)
     {
-        int newRow = grid->GetNumberRows();
-        grid->AppendRows(1);
-        grid->SetCellValue(newRow, 0, account.bank_);
-        grid->SetCellValue(newRow, 1, account.name_);
-        grid->SetCellValue(newRow, 2, wxString::Format("%#'.2f", account.balance()));
-        grid->SetCellValue(newRow, 3, wxString::Format("%.2f", account.interest()));
-        grid->SetCellValue(newRow, 4, account.type_);
+        const GroupResult &group = groups[i];
+        wxStaticText *groupBox = static_cast<wxStaticText *>(groupSizer->GetItem(i)->GetWindow());
+        groupBox->SetLabel(wxString::Format("%s: %s%#'.2f (%.2f%%)", group.name_, symbol, group.balance_, group.interestRate_));
     }
-    grid->AutoSizeColumns(); // Automatically size columns to fit content
-    grid->Refresh();
+    Layout();
+}
+
+FinanceSummary HomeFrame::Summarise()
+{
+    FinanceSummary summary = savedData.Summarise();
+    summary.groupTotals_ = groupBy.Totals(savedData.fxRates_, savedData.baseCurrency_);
+    return summary;
+}
+
+void HomeFrame::AddAccount(const Account &account)
+{
+    savedData.accountList_.push_back(account);
+    accountIndex.Insert(savedData.accountList_.size() - 1, account);
+    groupBy.Add(account);
+}
+
+void HomeFrame::UpdateAccount(size_t id, const Account &edited)
+{
+    Account &account = savedData.accountList_[id];
+    accountIndex.Update(id, account, edited);
+    groupBy.Update(account, edited);
+    account = edited;
+}
 
-    // Update summary boxes
-    summaryBoxes[0]->SetLabel("Total Balance: " + wxString::Format("%#'.2f", summary.totalBalance_));
-    summaryBoxes[1]->SetLabel("Current Balance: " + wxString::Format("%#'.2f", summary.currentBalance_));
-    summaryBoxes[2]->SetLabel("Savings Balance: " + wxString::Format("%#'.2f", summary.savingsBalance_));
-    summaryBoxes[3]->SetLabel("Credit Balance: " + wxString::Format("%#'.2f", summary.creditBalance_));
-    summaryBoxes[4]->SetLabel("ISA Balance: " + wxString::Format("%#'.2f", summary.isaBalance_));
-    summaryBoxes[5]->SetLabel("GIA Balance: " + wxString::Format("%#'.2f", summary.giaBalance_));
-    summaryBoxes[6]->SetLabel("Crypto Balance: " + wxString::Format("%#'.2f", summary.cryptoBalance_));
-    summaryBoxes[7]->SetLabel("Total Interest: " + wxString::Format("%#'.2f", summary.totalInterest_));
+void HomeFrame::RevalueAccounts(const std::vector<std::pair<size_t, double>> &balances)
+{
+    if (balances.empty())
+        return;
+
+    FinanceSummary &summary = savedData.currentSummary_;
+    for (const std::pair<size_t, double> &balance : balances)
+    {
+        Account edited = savedData.accountList_[balance.first];
+        edited.setBalance(balance.second);
+        summary.ApplyChange(savedData.accountList_[balance.first], edited, savedData.fxRates_);
+        UpdateAccount(balance.first, edited);
+    }
+    summary.groupTotals_ = groupBy.Totals(savedData.fxRates_, savedData.baseCurrency_);
+    accountsDirty = true;
+
+    // Balances do not affect the filter, so the visible rows only move when sorted by balance
+    if (gridTable->SortColumn() == FieldIndex<Account>("Balance"))
+        gridTable->RebuildView();
+    else
+        grid->ForceRefresh();
+    ShowSummary();
+}
+
+void HomeFrame::RemoveLastAccount()
+{
+    std::vector<Account> &accounts = savedData.accountList_;
+    accountIndex.Erase(accounts.size() - 1, accounts.back());
+    groupBy.Remove(accounts.back());
+    accounts.pop_back();
 }
 
 // HOME: Event handlers
@@ -284,60 +610,473 @@ void HomeFrame::OnVisualise(wxCommandEvent &WXUNUSED(event))
 
 void HomeFrame::OnSaveSummary(wxCommandEvent &WXUNUSED(event))
 {
-    savedData.currentSummary_.SaveFinanceSummary();
-    savedData.savedSummaryList_.push_back(savedData.currentSummary_);
+    // Queued snapshots are written either way, so saving never leaves rows only in memory
+    bool changed = CaptureSnapshot();
+    FlushSnapshots();
+    if (!missingCurrencies.empty())
+        SetStatusText("Summary not saved: some accounts have no exchange rate to the base currency");
+    else
+        SetStatusText(changed ? "Summary saved" : "Summary unchanged since last save");
+}
+
+void HomeFrame::OnAutoSnapshot(wxCommandEvent &WXUNUSED(event))
+{
+    long minutes = wxGetNumberFromUser("Minutes between automatic summary snapshots (0 to disable).",
+                                       "Minutes:", "Auto Snapshot", snapshotIntervalMinutes, 0, 24 * 60, this);
+    if (minutes < 0)
+        return;
+
+    snapshotIntervalMinutes = static_cast<int>(minutes);
+    snapshotScheduler.SetMaxAge(std::chrono::minutes(snapshotIntervalMinutes));
+    snapshotTimer.Stop();
+    if (snapshotIntervalMinutes > 0)
+        snapshotTimer.Start(snapshotIntervalMinutes * 60 * 1000);
 }
 
-void HomeFrame::OnGridCellChange(wxGridEvent &event)
+void HomeFrame::OnBaseCurrency(wxCommandEvent &WXUNUSED(event))
 {
-    int row = event.GetRow();
-    int col = event.GetCol();
-    wxString newValue = grid->GetCellValue(row, col);
+    wxString currency = wxGetTextFromUser("Currency code to show totals and history in, e.g. GBP, USD, EUR.",
+                                          "Base Currency", savedData.baseCurrency_, this);
+    if (currency.IsEmpty())
+        return;
 
-    // Ensure the row index is within the bounds of the account list
-    if (row >= 0 && row < static_cast<int>(savedData.accountList_.size()))
+    savedData.baseCurrency_ = currency.Upper().ToStdString();
+    LoadData();
+
+    // A forecast already shown is rerun over the same days in the new currency
+    if (!forecast.IsEmpty())
+        forecast = forecastEngine.Run(savedData.accountList_, savedData.fxRates_, savedData.baseCurrency_,
+                                      forecast.startDay_, static_cast<int>(forecast.series_[0].size()));
+    for (wxWindow *child : GetChildren())
     {
-        Account &account = savedData.accountList_[row];
+        VisualiseFrame *visualiseFrame = dynamic_cast<VisualiseFrame *>(child);
+        if (visualiseFrame)
+            visualiseFrame->OnBaseCurrencyChanged(forecast);
+    }
+}
 
-        switch (col)
-        {
-        case 0:
-            account.bank_ = newValue.ToStdString();
-            break;
-        case 1:
-            account.name_ = newValue.ToStdString();
-            break;
-        case 2:
+void HomeFrame::OnGroupBy(wxCommandEvent &WXUNUSED(event))
+{
+    wxArrayString choices;
+    wxArrayInt selections;
+    for (int key = 0; key < Group_Count; ++key)
+    {
+        choices.Add(GroupByEngine::KeyName(static_cast<GroupKey>(key)));
+    }
+    for (GroupKey key : groupBy.Keys())
+    {
+        selections.Add(key);
+    }
+
+    if (wxGetSelectedChoices(selections, "Group account totals by:", "Group By", choices, this) < 0)
+        return;
+
+    std::vector<GroupKey> keys;
+    for (int selection : selections)
+    {
+        keys.push_back(static_cast<GroupKey>(selection));
+    }
+    groupBy.Configure(keys, savedData.accountList_);
+    groupBy.SaveKeys();
+    LoadData();
+}
+
+void HomeFrame::OnForecast(wxCommandEvent &WXUNUSED(event))
+{
+    long years = wxGetNumberFromUser("Years of balances to forecast from the transactions in recurring.csv.",
+                                     "Years:", "Forecast", forecastYears, 1, 50, this);
+    if (years < 1)
+        return;
+    forecastYears = static_cast<int>(years);
+
+    wxStopWatch stopWatch;
+    forecastEngine.LoadRulesFromCSV();
+    forecast = forecastEngine.Run(savedData.accountList_, savedData.fxRates_, savedData.baseCurrency_,
+                                  Today() + 1, static_cast<int>(forecastYears * 365.25));
+    SetStatusText(wxString::Format("Forecast %zu recurring transactions over %d years in %ld ms",
+                                   forecastEngine.Rules().size(), forecastYears, stopWatch.Time()));
+
+    // Show the forecast in open plots, or open one if there are none
+    bool shown = false;
+    for (wxWindow *child : GetChildren())
+    {
+        VisualiseFrame *visualiseFrame = dynamic_cast<VisualiseFrame *>(child);
+        if (visualiseFrame)
         {
-            double balance;
-            if (newValue.ToDouble(&balance))
-            {
-                account.setBalance(balance);
-            }
-            break;
+            visualiseFrame->SetForecast(forecast);
+            shown = true;
         }
-        case 3:
+    }
+    if (!shown)
+        (new VisualiseFrame(this))->Show();
+}
+
+void HomeFrame::OnSnapshotTimer(wxTimerEvent &WXUNUSED(event))
+{
+    CaptureSnapshot();
+    if (snapshotScheduler.ShouldFlush())
+        FlushSnapshots();
+}
+
+bool HomeFrame::CaptureSnapshot()
+{
+    // Totals missing the accounts without exchange rates would be wrong in history
+    if (!missingCurrencies.empty())
+        return false;
+
+    FinanceSummary summary = Summarise();
+    if (!snapshotScheduler.Capture(summary))
+        return false;
+    savedData.AddSnapshot(summary);
+    return true;
+}
+
+void HomeFrame::FlushSnapshots()
+{
+    std::vector<FinanceSummary> pending = snapshotScheduler.TakePending();
+    if (pending.empty())
+        return;
+
+    std::vector<FinanceSummary> external;
+    if (!savedData.AppendSummariesToCSV(pending, external))
+        ResetSnapshotBaseline();
+}
+
+void HomeFrame::OnWatchTimer(wxTimerEvent &WXUNUSED(event))
+{
+    std::set<std::string> changed = fileWatcher.Poll();
+    if (changed.count("accounts.csv"))
+        ReloadAccounts();
+    if (changed.count("history.csv"))
+        ReloadHistory();
+
+    // Checked here rather than on the snapshot timer, which may fire just short of the maximum age
+    if (snapshotScheduler.ShouldFlush())
+        FlushSnapshots();
+}
+
+void HomeFrame::OnPriceTimer(wxTimerEvent &WXUNUSED(event))
+{
+    // Ticks since the last frame are coalesced to the latest price per instrument
+    priceFeed.Poll();
+    std::unordered_map<std::string, double> prices = priceFeed.Drain();
+    if (!prices.empty())
+    {
+        std::set<std::string> revalued;
+        holdings.ApplyPrices(prices, revalued);
+
+        // Only the accounts holding a ticked instrument are looked at
+        std::vector<std::pair<size_t, double>> balances;
+        std::vector<size_t> ids;
+        for (const std::string &name : revalued)
         {
-            double interest;
-            if (newValue.ToDouble(&interest))
+            // Accounts are only valued once all their instruments have a price
+            if (!holdings.Priced(name))
+                continue;
+            // Holdings name their account, which must then be the only account with that name
+            accountIndex.Named(name, ids);
+            if (ids.size() > 1)
             {
-                account.setInterest(interest);
+                ReportSharedHolding(name, ids.size());
+                continue;
             }
-            break;
+            if (ids.size() == 1)
+                balances.emplace_back(ids[0], holdings.Value(name));
         }
-        case 4:
-            account.type_ = newValue.ToStdString();
-            break;
-        default:
-            break;
+        RevalueAccounts(balances);
+    }
+
+    if (accountsDirty && wxGetLocalTimeMillis() - accountsWrittenAt >= 1000)
+        PersistAccounts();
+}
+
+void HomeFrame::ReportSharedHolding(const std::string &name, size_t accounts)
+{
+    if (!sharedHoldings.insert(name).second)
+        return;
+    wxString message = wxString::Format("Holdings of %s not valued: %zu accounts have that name", name, accounts);
+    std::cerr << message << std::endl;
+    SetStatusText(message);
+}
+
+void HomeFrame::PersistAccounts()
+{
+    // If another writer got in first, merge their changes and try again
+    for (int attempt = 0; attempt < 3; ++attempt)
+    {
+        if (savedData.UpdateAccountsInCSV(savedData.accountList_))
+        {
+            accountsDirty = false;
+            accountsWrittenAt = wxGetLocalTimeMillis();
+            return;
         }
+        ReloadAccounts();
+    }
+    // Still contended, leave it to the next deferred write
+    accountsDirty = true;
+}
+
+void HomeFrame::ReloadAccounts()
+{
+    // Our own writes are reported too, and leave the file as it was last written
+    if (!savedData.AccountsFileChanged())
+        return;
+
+    // Merge against the file as last read or written: rows another writer changed come from
+    // the file, the rest keep edits not yet written
+    std::vector<Account> stored = savedData.StoredAccounts();
+    std::vector<Account> loaded = savedData.LoadAccountsFromCSV();
+    std::vector<Account> &accounts = savedData.accountList_;
+    bool changed = false;
+
+    // Holdings only value an account whose name no other account in the file has
+    std::unordered_map<std::string, size_t> heldNames;
+    for (const Account &account : loaded)
+    {
+        if (holdings.Holds(account.name_))
+            ++heldNames[account.name_];
+    }
 
-        // Update accounts csv
-        savedData.UpdateAccountsInCSV(savedData.accountList_);
-        savedData.currentSummary_ = FinanceSummary(savedData.accountList_);
+    // Accounts are matched by row, only rows that differ touch the indexes
+    size_t common = std::min(loaded.size(), accounts.size());
+    for (size_t id = 0; id < common; ++id)
+    {
+        if (id < stored.size() && loaded[id].SameAs(stored[id]))
+            continue;
+
+        // Valuations from the price feed are newer than any balance waiting to be written
+        const std::string &name = loaded[id].name_;
+        auto held = heldNames.find(name);
+        if (held != heldNames.end() && held->second == 1 && holdings.Priced(name))
+            loaded[id].setBalance(holdings.Value(name));
+        else if (held != heldNames.end() && held->second > 1)
+            ReportSharedHolding(name, held->second);
+
+        if (!accounts[id].SameAs(loaded[id]))
+        {
+            UpdateAccount(id, loaded[id]);
+            changed = true;
+        }
+    }
+    while (accounts.size() > loaded.size())
+    {
+        RemoveLastAccount();
+        changed = true;
+    }
+    for (size_t id = accounts.size(); id < loaded.size(); ++id)
+    {
+        AddAccount(loaded[id]);
+        changed = true;
+    }
 
-        // Optionally, you can refresh the grid or the entire UI to reflect other dependent changes
+    // Our own writes land here too and change nothing
+    if (changed)
         LoadData();
+}
+
+void HomeFrame::ReloadHistory()
+{
+    // Open plots are told about new rows by savedData
+    std::vector<FinanceSummary> added;
+    if (!savedData.ReadNewSummaries(added))
+        ResetSnapshotBaseline();
+}
+
+void HomeFrame::ResetSnapshotBaseline()
+{
+    // A rewritten history may no longer end with the last snapshot taken
+    if (!savedData.savedSummaryList_.empty())
+        snapshotScheduler.SetLastStored(savedData.savedSummaryList_.back());
+}
+
+void HomeFrame::OnClose(wxCloseEvent &event)
+{
+    // Write out any snapshots still waiting for a full batch
+    snapshotTimer.Stop();
+    watchTimer.Stop();
+    priceTimer.Stop();
+    FlushSnapshots();
+    if (accountsDirty)
+        PersistAccounts();
+    event.Skip();
+}
+
+void HomeFrame::OnGridCellChange(wxGridEvent &WXUNUSED(event))
+{
+    // The grid table has already applied the edit to the account and its indexes
+    PersistAccounts();
+    LoadData();
+}
+
+void HomeFrame::OnGridEditorHidden(wxGridEvent &event)
+{
+    // Catch up on rebuilds held back while editing, once the grid has finished closing the editor
+    event.Skip();
+    CallAfter([this]
+              {
+                  if (gridTable->ViewStale())
+                      gridTable->RebuildView(); });
+}
+
+void HomeFrame::OnGridLabelClick(wxGridEvent &event)
+{
+    // Only column headers sort
+    if (event.GetRow() != -1 || event.GetCol() < 0)
+    {
+        event.Skip();
+        return;
+    }
+    gridTable->SortByColumn(event.GetCol());
+    grid->SetSortingColumn(gridTable->SortColumn(), gridTable->SortAscending());
+    gridTable->RebuildView();
+}
+
+void HomeFrame::OnFilter(wxCommandEvent &WXUNUSED(event))
+{
+    gridTable->SetFilter(filterCtrl->GetValue());
+    gridTable->RebuildView();
+}
+
+// HOME: Account grid table
+AccountGridTable::AccountGridTable(SavedData &data, AccountIndex &index, std::function<void(size_t, const Account &)> applyEdit)
+    : data(data), index(index), applyEdit(applyEdit), sortColumn(-1), sortAscending(true), viewStale(false)
+{
+}
+
+int AccountGridTable::GetNumberRows() { return static_cast<int>(rows.size()); }
+
+int AccountGridTable::GetNumberCols() { return static_cast<int>(FieldCount<Account>); }
+
+bool AccountGridTable::IsEmptyCell(int row, int col) { return GetValue(row, col).IsEmpty(); }
+
+wxString AccountGridTable::GetValue(int row, int col)
+{
+    // Rows held while editing may name accounts that have since been removed
+    if (row < 0 || row >= static_cast<int>(rows.size()) || rows[row] >= data.accountList_.size())
+        return wxEmptyString;
+
+    // Columns are the fields of Schema<Account>, in order
+    const Account &account = data.accountList_[rows[row]];
+    wxString value;
+    ForEachFieldIndexed<Account>([&](const auto &field, auto i)
+                                 {
+                                     if (static_cast<int>(decltype(i)::value) != col)
+                                         return;
+                                     if constexpr (IsNumericField<decltype(field)>)
+                                         value = wxString::Format("%#'.2f", account.*field.member_);
+                                     else
+                                         value = account.*field.member_; });
+    return value;
+}
+
+void AccountGridTable::SetValue(int row, int col, const wxString &value)
+{
+    // Ensure the row index is within the visible rows
+    if (row < 0 || row >= static_cast<int>(rows.size()) || rows[row] >= data.accountList_.size())
+        return;
+
+    size_t id = rows[row];
+    Account edited = data.accountList_[id];
+
+    bool valid = true;
+    ForEachFieldIndexed<Account>([&](const auto &field, auto i)
+                                 {
+                                     if (static_cast<int>(decltype(i)::value) != col)
+                                         return;
+                                     if constexpr (IsNumericField<decltype(field)>)
+                                         valid = value.ToDouble(&(edited.*field.member_));
+                                     else
+                                         edited.*field.member_ = value.ToStdString(); });
+    if (!valid)
+        return;
+
+    // Reject types the rest of the program cannot summarise, leaving the cell as it was
+    if (!Account::ValidType(edited.type_))
+    {
+        wxMessageBox(wxString::Format("\"%s\" is not a valid account type", value), "Error", wxOK | wxICON_ERROR, GetView());
+        return;
+    }
+    edited.currency_ = wxString(edited.currency_).Upper().ToStdString();
+
+    applyEdit(id, edited);
+}
+
+wxString AccountGridTable::GetColLabelValue(int col)
+{
+    wxString label;
+    ForEachFieldIndexed<Account>([&](const auto &field, auto i)
+                                 {
+                                     if (static_cast<int>(decltype(i)::value) == col)
+                                         label = field.Label(); });
+    return label;
+}
+
+void AccountGridTable::SortByColumn(int col)
+{
+    sortAscending = (col == sortColumn) ? !sortAscending : true;
+    sortColumn = col;
+}
+
+int AccountGridTable::SortColumn() const { return sortColumn; }
+
+bool AccountGridTable::SortAscending() const { return sortAscending; }
+
+void AccountGridTable::SetFilter(const wxString &text)
+{
+    filter = text.utf8_str();
+}
+
+bool AccountGridTable::ViewStale() const { return viewStale; }
+
+void AccountGridTable::RebuildView()
+{
+    // Rows keep their accounts while a cell is being edited, e.g. as price ticks move balances,
+    // so the edit is applied to the account it was started on
+    if (GetView() && GetView()->IsCellEditControlEnabled())
+    {
+        viewStale = true;
+        GetView()->ForceRefresh();
+        return;
+    }
+    viewStale = false;
+    int oldCount = static_cast<int>(rows.size());
+
+    // Matched against the lower-cased search keys kept by the index
+    std::vector<bool> matches;
+    const std::vector<bool> *keep = nullptr;
+    if (!filter.empty())
+    {
+        index.Matching(filter, matches);
+        keep = &matches;
+    }
+
+    // Grid columns line up with AccountKey, unsorted keeps file order
+    if (sortColumn >= 0)
+    {
+        index.Ordered(static_cast<AccountKey>(sortColumn), sortAscending, keep, rows);
+    }
+    else
+    {
+        rows.clear();
+        for (size_t id = 0; id < data.accountList_.size(); ++id)
+            if (!keep || (*keep)[id])
+                rows.push_back(id);
+    }
+
+    int newCount = static_cast<int>(rows.size());
+    if (GetView())
+    {
+        if (newCount < oldCount)
+        {
+            wxGridTableMessage msg(this, wxGRIDTABLE_NOTIFY_ROWS_DELETED, newCount, oldCount - newCount);
+            GetView()->ProcessTableMessage(msg);
+        }
+        else if (newCount > oldCount)
+        {
+            wxGridTableMessage msg(this, wxGRIDTABLE_NOTIFY_ROWS_APPENDED, newCount - oldCount);
+            GetView()->ProcessTableMessage(msg);
+        }
+        GetView()->ForceRefresh();
     }
 }
 
@@ -353,34 +1092,26 @@ AccountAddFrame::AccountAddFrame(wxWindow *parent)
     const int controlHeight = -1;
     const int borderSize = 5;
 
-    wxStaticText *bankLabel = new wxStaticText(panel, wxID_ANY, "Bank");
-    bankCtrl = new wxTextCtrl(panel, wxID_ANY, "", wxDefaultPosition, wxSize(controlWidth, controlHeight));
-    vbox->Add(bankLabel, 0, wxALL, borderSize);
-    vbox->Add(bankCtrl, 0, wxALL | wxEXPAND, borderSize);
-
-    wxStaticText *nameLabel = new wxStaticText(panel, wxID_ANY, "Name");
-    nameCtrl = new wxTextCtrl(panel, wxID_ANY, "", wxDefaultPosition, wxSize(controlWidth, controlHeight));
-    vbox->Add(nameLabel, 0, wxALL, borderSize);
-    vbox->Add(nameCtrl, 0, wxALL | wxEXPAND, borderSize);
-
-    wxStaticText *balanceLabel = new wxStaticText(panel, wxID_ANY, "Balance");
-    balanceCtrl = new wxSpinCtrlDouble(panel, wxID_ANY, "", wxDefaultPosition, wxSize(controlWidth, controlHeight));
-    balanceCtrl->SetRange(-10000, 10000);
-    balanceCtrl->SetIncrement(0.01);
-    vbox->Add(balanceLabel, 0, wxALL, borderSize);
-    vbox->Add(balanceCtrl, 0, wxALL | wxEXPAND, borderSize);
-
-    wxStaticText *interestLabel = new wxStaticText(panel, wxID_ANY, "Interest");
-    interestCtrl = new wxSpinCtrlDouble(panel, wxID_ANY, "", wxDefaultPosition, wxSize(controlWidth, controlHeight));
-    interestCtrl->SetRange(-10000, 10000);
-    interestCtrl->SetIncrement(0.01);
-    vbox->Add(interestLabel, 0, wxALL, borderSize);
-    vbox->Add(interestCtrl, 0, wxALL | wxEXPAND, borderSize);
-
-    wxStaticText *typeLabel = new wxStaticText(panel, wxID_ANY, "Type");
-    typeCtrl = new wxTextCtrl(panel, wxID_ANY, "", wxDefaultPosition, wxSize(controlWidth, controlHeight));
-    vbox->Add(typeLabel, 0, wxALL, borderSize);
-    vbox->Add(typeCtrl, 0, wxALL | wxEXPAND, borderSize);
+    // New accounts start out as current accounts in the pivot currency
+    const Account defaults("", "", 0, 0, "Current");
+    ForEachFieldIndexed<Account>([&](const auto &field, auto i)
+                                 {
+                                     wxWindow *ctrl;
+                                     if constexpr (IsNumericField<decltype(field)>)
+                                     {
+                                         wxSpinCtrlDouble *spinCtrl = new wxSpinCtrlDouble(panel, wxID_ANY, "", wxDefaultPosition, wxSize(controlWidth, controlHeight));
+                                         spinCtrl->SetRange(-10000, 10000);
+                                         spinCtrl->SetIncrement(0.01);
+                                         spinCtrl->SetValue(defaults.*field.member_);
+                                         ctrl = spinCtrl;
+                                     }
+                                     else
+                                     {
+                                         ctrl = new wxTextCtrl(panel, wxID_ANY, defaults.*field.member_, wxDefaultPosition, wxSize(controlWidth, controlHeight));
+                                     }
+                                     fieldCtrls[decltype(i)::value] = ctrl;
+                                     vbox->Add(new wxStaticText(panel, wxID_ANY, field.Label()), 0, wxALL, borderSize);
+                                     vbox->Add(ctrl, 0, wxALL | wxEXPAND, borderSize); });
 
     wxButton *submitBtn = new wxButton(panel, wxID_ANY, "Submit");
     vbox->Add(submitBtn, 0, wxALL | wxALIGN_CENTER, borderSize);
@@ -396,25 +1127,35 @@ void AccountAddFrame::OnSubmit(wxCommandEvent &event)
 {
     try
     {
-        wxString name = nameCtrl->GetValue();
-        wxString bank = bankCtrl->GetValue();
-        wxString type = typeCtrl->GetValue();
-
-        if (name.IsEmpty() || bank.IsEmpty() || type.IsEmpty())
+        Account newAccount("", "", 0, 0, "Current");
+        bool empty = false;
+        ForEachFieldIndexed<Account>([&](const auto &field, auto i)
+                                     {
+                                         wxWindow *ctrl = fieldCtrls[decltype(i)::value];
+                                         if constexpr (IsNumericField<decltype(field)>)
+                                         {
+                                             newAccount.*field.member_ = static_cast<wxSpinCtrlDouble *>(ctrl)->GetValue();
+                                         }
+                                         else
+                                         {
+                                             newAccount.*field.member_ = static_cast<wxTextCtrl *>(ctrl)->GetValue().ToStdString();
+                                             // Fields every accounts CSV row has must be filled in
+                                             empty = empty || (decltype(i)::value < Schema<Account>::required_ && (newAccount.*field.member_).empty());
+                                         } });
+
+        if (empty || newAccount.currency_.empty())
         {
             throw std::invalid_argument("Fields are empty");
         }
 
-        double balance = balanceCtrl->GetValue();
-        double interest = interestCtrl->GetValue();
-
         // Process the data
-        Account newAccount(name.ToStdString(), bank.ToStdString(), balance, interest, type.ToStdString());
+        newAccount.currency_ = wxString(newAccount.currency_).Upper().ToStdString();
+        newAccount.Validate();
 
         HomeFrame *parentFrame = dynamic_cast<HomeFrame *>(GetParent());
         if (parentFrame)
         {
-            parentFrame->savedData.accountList_.push_back(newAccount);
+            parentFrame->AddAccount(newAccount);
             newAccount.AddAccountToCSV();
             parentFrame->LoadData();
         }
@@ -427,47 +1168,99 @@ void AccountAddFrame::OnSubmit(wxCommandEvent &event)
     }
 }
 
+// VISUALISE: Line layer
+LineLayer::LineLayer(const wxString &name, const wxColour &colour)
+    : mpFXY(name), position(0)
+{
+    Clear();
+    SetContinuity(true);
+    SetPen(wxPen(colour, 2, wxSOLID));
+    SetDrawOutsideMargins(false);
+}
+
+void LineLayer::Rewind() { position = 0; }
+
+bool LineLayer::GetNextXY(double &x, double &y)
+{
+    if (position >= xs.size())
+        return false;
+    x = xs[position];
+    y = ys[position];
+    ++position;
+    return true;
+}
+
+// An empty layer reports a zero-sized box rather than its sentinel bounds
+double LineLayer::GetMinX() { return xs.empty() ? 0 : minX; }
+
+double LineLayer::GetMaxX() { return xs.empty() ? 0 : maxX; }
+
+double LineLayer::GetMinY() { return xs.empty() ? 0 : minY; }
+
+double LineLayer::GetMaxY() { return xs.empty() ? 0 : maxY; }
+
+void LineLayer::Append(double x, double y)
+{
+    xs.push_back(x);
+    ys.push_back(y);
+    minX = std::min(minX, x);
+    maxX = std::max(maxX, x);
+    minY = std::min(minY, y);
+    maxY = std::max(maxY, y);
+}
+
+void LineLayer::Clear()
+{
+    xs.clear();
+    ys.clear();
+    position = 0;
+    minX = minY = std::numeric_limits<double>::max();
+    maxX = maxY = std::numeric_limits<double>::lowest();
+}
+
 // VISUALISE: Frame constructor
 VisualiseFrame::VisualiseFrame(wxWindow *parent)
-    : wxFrame(parent, wxID_ANY, "Visualise Financial Summaries", wxDefaultPosition, wxSize(800, 600))
+    : wxFrame(parent, wxID_ANY, "Visualise Financial Summaries", wxDefaultPosition, wxSize(800, 600)),
+      savedData(dynamic_cast<HomeFrame *>(parent)->savedData)
 {
     CreatePlot();
+    CreateAnalyticsPlot();
+
+    // Balances above, analytics over the selected window below
+    wxBoxSizer *windowSizer = new wxBoxSizer(wxHORIZONTAL);
+    windowSizer->Add(new wxStaticText(this, wxID_ANY, "Analytics window (snapshots)"), 0, wxALIGN_CENTER_VERTICAL | wxRIGHT, 5);
+    windowSizer->Add(windowCtrl, 0);
+    wxBoxSizer *sizer = new wxBoxSizer(wxVERTICAL);
+    sizer->Add(plotWindow, 2, wxEXPAND);
+    sizer->Add(windowSizer, 0, wxALL, 5);
+    sizer->Add(analyticsWindow, 1, wxEXPAND);
+    SetSizer(sizer);
+
+    OnHistoryReset();
+    SetForecast(dynamic_cast<HomeFrame *>(parent)->forecast);
+    savedData.AddHistoryObserver(this);
+}
+
+VisualiseFrame::~VisualiseFrame()
+{
+    savedData.RemoveHistoryObserver(this);
 }
 
 void VisualiseFrame::CreatePlot()
 {
     // Create a new mpWindow
-    mpWindow *plotWindow = new mpWindow(this, wxID_ANY, wxDefaultPosition, wxSize(800, 600), wxSUNKEN_BORDER);
+    plotWindow = new mpWindow(this, wxID_ANY, wxDefaultPosition, wxSize(800, 600), wxSUNKEN_BORDER);
+    const std::string &baseCurrency = savedData.baseCurrency_;
 
     // Create and add layer for the X and Y axes
-    mpScaleX *xAxis = new mpScaleX(wxT("Date"), mpALIGN_BORDER_BOTTOM, true);
-    mpScaleY *yAxis = new mpScaleY(wxT("Balance (£)"), mpALIGN_LEFT, true);
+    mpScaleX *xAxis = new mpScaleX(wxT("Days from today"), mpALIGN_BORDER_BOTTOM, true);
+    yAxis = new mpScaleY(wxString::Format(wxT("Balance (%s)"), baseCurrency), mpALIGN_LEFT, true);
     xAxis->SetTicks(false);
     yAxis->SetTicks(false);
     plotWindow->AddLayer(xAxis);
     plotWindow->AddLayer(yAxis);
 
-    // Define a custom line layer class
-    class LineLayer : public mpFXYVector
-    {
-    public:
-        LineLayer(const wxString &name, const std::vector<double> &xData, const std::vector<double> &yData, const wxColour &colour = *wxBLUE)
-            : mpFXYVector(name)
-        {
-            SetData(xData, yData);
-            SetContinuity(true);
-            SetPen(wxPen(colour, 2, wxSOLID));
-            SetDrawOutsideMargins(false);
-        }
-    };
-
-    // Get the parent frame
-    HomeFrame *parentFrame = dynamic_cast<HomeFrame *>(GetParent());
-
-    // Retrieve the finance summary points from the parent frame
-    auto financeSummaryPoints = parentFrame->savedData.getFinanceSummaryPoints();
-
-    // Define line colors and names
+    // Define line colors
     const std::vector<wxColour> lineColors = {
         wxColor(255, 0, 0),   // Red
         wxColor(0, 255, 0),   // Green
@@ -479,66 +1272,209 @@ void VisualiseFrame::CreatePlot()
         wxColor(0, 128, 0)    // Dark Green
     };
 
-    const std::vector<wxString> lineNames = {
-        wxT("Total"),
-        wxT("Current"),
-        wxT("Savings"),
-        wxT("Credit"),
-        wxT("ISA"),
-        wxT("GIA"),
-        wxT("Crypto"),
-        wxT("Interest")};
-
     // Create a legend
     wxRect legendRect(100, 100, 200, 100);
     mpInfoLegend *legend = new mpInfoLegend(legendRect);
     plotWindow->AddLayer(legend);
 
-    // Iterate over each finance summary point
-    for (size_t i = 0; i < financeSummaryPoints.size(); ++i)
-    {
-        const auto &point = financeSummaryPoints[i];
-
-        // Extract the labels (dates) and values from the tuple
-        const std::vector<double> &labels = std::get<0>(point);
-        const std::vector<double> &values = std::get<1>(point);
-
-        // Create a new line layer for each finance summary point with the corresponding color and name
-        wxString lineName = (i < lineNames.size()) ? lineNames[i] : wxString::Format(wxT("Line %d"), i + 1);
-        wxColour lineColor = (i < lineColors.size()) ? lineColors[i] : *wxBLACK;
-        LineLayer *lineLayer = new LineLayer(lineName, labels, values, lineColor);
-        plotWindow->AddLayer(lineLayer);
-    }
+    // Create a line layer per summary balance with the corresponding color and name
+    ForEachNumericField<FinanceSummary>([&](const auto &field)
+                                        {
+                                            LineLayer *lineLayer = new LineLayer(field.name_, lineColors[lineLayers.size() % lineColors.size()]);
+                                            lineLayers.push_back(lineLayer);
+                                            plotWindow->AddLayer(lineLayer); });
 
     // Disable mouse pan and zoom
     plotWindow->EnableMousePanZoom(false);
 
-    // Find the minimum and maximum Y values
-    double minY = std::numeric_limits<double>::max();
-    double maxY = std::numeric_limits<double>::lowest();
-    double minX = std::numeric_limits<double>::max();
-    double maxX = std::numeric_limits<double>::lowest();
+    // Enable auto-scaling for the Y-axis based on the largest value plotted
+    yAxis->SetLabelFormat(CurrencySymbol(baseCurrency) + wxT("%.2f"));
+}
+
+void VisualiseFrame::CreateAnalyticsPlot()
+{
+    analyticsWindow = new mpWindow(this, wxID_ANY, wxDefaultPosition, wxSize(800, 300), wxSUNKEN_BORDER);
+
+    mpScaleX *xAxis = new mpScaleX(wxT("Days from today"), mpALIGN_BORDER_BOTTOM, true);
+    mpScaleY *yAxis = new mpScaleY(wxT("%"), mpALIGN_LEFT, true);
+    xAxis->SetTicks(false);
+    yAxis->SetTicks(false);
+    yAxis->SetLabelFormat(wxT("%.1f%%"));
+    analyticsWindow->AddLayer(xAxis);
+    analyticsWindow->AddLayer(yAxis);
+    analyticsWindow->AddLayer(new mpInfoLegend(wxRect(100, 20, 200, 80)));
+
+    const std::vector<wxColour> metricColors = {
+        wxColor(0, 0, 255),   // Blue
+        wxColor(0, 128, 0),   // Dark Green
+        wxColor(255, 0, 0),   // Red
+        wxColor(255, 128, 0), // Orange
+        wxColor(128, 0, 128)  // Purple
+    };
+    ForEachNumericField<AnalyticsPoint>([&](const auto &field)
+                                        {
+                                            LineLayer *analyticsLayer = new LineLayer(field.Label(), metricColors[analyticsLayers.size() % metricColors.size()]);
+                                            analyticsLayers.push_back(analyticsLayer);
+                                            analyticsWindow->AddLayer(analyticsLayer); });
+    analyticsWindow->EnableMousePanZoom(false);
+
+    windowCtrl = new wxSpinCtrl(this, wxID_ANY, wxEmptyString, wxDefaultPosition, wxDefaultSize, wxSP_ARROW_KEYS,
+                                2, 1000, static_cast<int>(analytics.Window()));
+    windowCtrl->Bind(wxEVT_SPINCTRL, &VisualiseFrame::OnWindowChange, this);
+}
+
+void VisualiseFrame::OnWindowChange(wxSpinEvent &event)
+{
+    analytics.SetWindow(static_cast<size_t>(event.GetPosition()));
+    OnHistoryReset();
+}
+
+void VisualiseFrame::OnHistoryReset()
+{
+    for (LineLayer *lineLayer : lineLayers)
+    {
+        lineLayer->Clear();
+    }
+    for (auto &groupLayer : groupLayers)
+    {
+        groupLayer.second->Clear();
+    }
+    for (LineLayer *analyticsLayer : analyticsLayers)
+    {
+        analyticsLayer->Clear();
+    }
+    analytics.Reset();
+    analyticsMinY = std::numeric_limits<double>::max();
+    analyticsMaxY = std::numeric_limits<double>::lowest();
+    lastX = -static_cast<double>(savedData.savedSummaryList_.size());
+    minX = minY = std::numeric_limits<double>::max();
+    maxX = maxY = std::numeric_limits<double>::lowest();
+
+    for (const FinanceSummary &summary : savedData.savedSummaryList_)
+    {
+        AppendPoint(summary);
+    }
+    for (LineLayer *forecastLayer : forecastLayers)
+    {
+        IncludeInBounds(forecastLayer->GetMinX(), forecastLayer->GetMinY());
+        IncludeInBounds(forecastLayer->GetMaxX(), forecastLayer->GetMaxY());
+    }
+    FitPlot();
+}
+
+void VisualiseFrame::SetForecast(const Forecast &forecast)
+{
+    if (forecast.IsEmpty())
+        return;
 
+    // Forecast series are the total followed by each type, in the same order as the history layers
+    for (size_t i = forecastLayers.size(); i < forecast.series_.size() && i < lineLayers.size(); ++i)
+    {
+        LineLayer *forecastLayer = new LineLayer(wxString(forecast.names_[i]) + wxT(" (forecast)"), lineLayers[i]->GetPen().GetColour());
+        forecastLayer->SetPen(wxPen(lineLayers[i]->GetPen().GetColour(), 2, wxPENSTYLE_SHORT_DASH));
+        forecastLayers.push_back(forecastLayer);
+        plotWindow->AddLayer(forecastLayer);
+    }
 
-    for (const auto &point : financeSummaryPoints)
+    double offset = forecast.startDay_ - Today();
+    for (size_t i = 0; i < forecastLayers.size(); ++i)
     {
-        const std::vector<double> &labels = std::get<0>(point);
-        std::cout << labels[1];
-        const std::vector<double> &values = std::get<1>(point);
-        for (double value : values)
+        LineLayer *forecastLayer = forecastLayers[i];
+        const std::vector<double> &series = forecast.series_[i];
+        forecastLayer->Clear();
+        for (size_t day = 0; day < series.size(); ++day)
         {
-            minY = std::min(minY, value);
-            maxY = std::max(maxY, value);
+            forecastLayer->Append(offset + day, series[day]);
         }
-        for (double label : labels)
+    }
+
+    // Bounds may shrink when a shorter forecast replaces a longer one
+    OnHistoryReset();
+}
+
+void VisualiseFrame::OnBaseCurrencyChanged(const Forecast &forecast)
+{
+    const std::string &baseCurrency = savedData.baseCurrency_;
+    yAxis->SetName(wxString::Format(wxT("Balance (%s)"), baseCurrency));
+    yAxis->SetLabelFormat(CurrencySymbol(baseCurrency) + wxT("%.2f"));
+
+    // History is revalued as it is replayed
+    if (forecast.IsEmpty())
+        OnHistoryReset();
+    else
+        SetForecast(forecast);
+}
+
+void VisualiseFrame::OnSummariesAdded(const std::vector<FinanceSummary> &added)
+{
+    for (const FinanceSummary &summary : added)
+    {
+        AppendPoint(summary);
+    }
+    FitPlot();
+}
+
+void VisualiseFrame::AppendPoint(const FinanceSummary &saved)
+{
+    // Revalue the snapshot in the base currency at its own date, skipping it if that is not possible
+    if (!savedData.fxRates_.Converts(saved.currency_, savedData.baseCurrency_))
+        return;
+    FinanceSummary summary = saved.ConvertedTo(savedData.baseCurrency_, savedData.fxRates_);
+    // Snapshots are placed at their time of day, so several taken on one day keep their order
+    double day;
+    double x = ParseSummaryDate(summary.date_, day) ? day - Today() : lastX + 1;
+    std::array<double, NumericFieldCount<FinanceSummary>> values = NumericValues(summary);
+
+    for (size_t i = 0; i < lineLayers.size(); ++i)
+    {
+        lineLayers[i]->Append(x, values[i]);
+        IncludeInBounds(x, values[i]);
+    }
+
+    // Snapshots carry whichever groups were configured when they were taken
+    for (const auto &group : summary.groupTotals_)
+    {
+        LineLayer *&groupLayer = groupLayers[group.first];
+        if (!groupLayer)
         {
-            minX = std::min(minX, label);
-            maxX = std::max(maxX, label);
+            size_t i = groupLayers.size();
+            groupLayer = new LineLayer(wxString(group.first), wxColour(64 + (i * 97) % 192, 64 + (i * 57) % 192, 64 + (i * 37) % 192));
+            plotWindow->AddLayer(groupLayer);
         }
+        groupLayer->Append(x, group.second);
+        IncludeInBounds(x, group.second);
     }
 
-    plotWindow->Fit(minX-1, maxX+1, minY - 1000, maxY + 1000);
+    // Analytics step forward by one snapshot in constant time
+    std::array<double, NumericFieldCount<AnalyticsPoint>> metrics = NumericValues(analytics.Add(summary));
+    for (size_t i = 0; i < analyticsLayers.size(); ++i)
+    {
+        analyticsLayers[i]->Append(x, metrics[i]);
+        analyticsMinY = std::min(analyticsMinY, metrics[i]);
+        analyticsMaxY = std::max(analyticsMaxY, metrics[i]);
+    }
+    lastX = x;
+}
 
-    // Enable auto-scaling for the Y-axis based on the largest value plotted
-    yAxis->SetLabelFormat(wxT("£%.2f"));
+void VisualiseFrame::IncludeInBounds(double x, double y)
+{
+    minX = std::min(minX, x);
+    maxX = std::max(maxX, x);
+    minY = std::min(minY, y);
+    maxY = std::max(maxY, y);
+}
+
+void VisualiseFrame::FitPlot()
+{
+    if (minX > maxX)
+    {
+        plotWindow->UpdateAll();
+        analyticsWindow->UpdateAll();
+        return;
+    }
+    plotWindow->Fit(minX - 1, maxX + 1, minY - 1000, maxY + 1000);
+    if (analyticsMinY <= analyticsMaxY)
+        analyticsWindow->Fit(minX - 1, maxX + 1, analyticsMinY - 1, analyticsMaxY + 1);
+    else
+        analyticsWindow->UpdateAll();
 }